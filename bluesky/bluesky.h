@@ -3,7 +3,12 @@
 
 #include "log.h"
 #include "config.h"
+#include "persistent_map.h"
+#include "config_watcher.h"
+#include "config_snapshot.h"
+#include "config_struct.h"
 #include "log_config.h"
+#include "log_socket.h"
 #include "locker.h"
 #include "thread.h"
 #include "util.h"
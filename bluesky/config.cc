@@ -1,5 +1,16 @@
 #include "bluesky/config.h"
+#include "bluesky/util.h"
 #include <list>
+#include <deque>
+#include <fstream>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <string.h>
+#include <stdio.h>
+#include <ctype.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <algorithm>
 
 namespace bluesky
 {
@@ -28,55 +39,1258 @@ namespace bluesky
         }
     }
 
-    //找出所有键值对
-    void Config::load_from_yaml(const YAML::Node &root)
+    void ConfigTransaction::add(const ConfigVarBase::Ptr &var, const ConfigVarBase::Pending::Ptr &pending,
+                                const std::string &error)
+    {
+        if (pending)
+        {
+            Change change;
+            change.var = var;
+            change.pending = pending;
+            change.source = source_;
+            changes_.push_back(change);
+        }
+        else
+        {
+            errors_.push_back(var->get_configname() + ": " + error);
+        }
+    }
+
+    bool ConfigTransaction::set_string(const ConfigVarBase::Ptr &var, const std::string &value)
+    {
+        std::string error;
+        ConfigVarBase::Pending::Ptr pending = var->stage_string(value, error);
+        add(var, pending, error);
+        return pending != nullptr;
+    }
+
+    bool ConfigTransaction::set_node(const ConfigVarBase::Ptr &var, const YAML::Node &node)
+    {
+        std::string error;
+        ConfigVarBase::Pending::Ptr pending = var->stage_node(node, error);
+        add(var, pending, error);
+        return pending != nullptr;
+    }
+
+    void ConfigTransaction::reset(const ConfigVarBase::Ptr &var)
+    {
+        ConfigSource::Type source = source_;
+        source_ = ConfigSource::DEFAULT;
+        add(var, var->stage_erased(var->get_default()), "");
+        source_ = source;
+    }
+
+    bool ConfigTransaction::set_binary(const ConfigVarBase::Ptr &var, const char *data, size_t size)
+    {
+        std::string error;
+        ConfigVarBase::Pending::Ptr pending = var->stage_binary(data, size, error);
+        add(var, pending, error);
+        return pending != nullptr;
+    }
+
+    const char *ConfigSource::to_string(Type type)
+    {
+        switch (type)
+        {
+        case DEFAULT:
+            return "default";
+        case FILE:
+            return "file";
+        case ENV:
+            return "env";
+        case ARGV:
+            return "argv";
+        case RUNTIME:
+            return "runtime";
+        default:
+            return "unknown";
+        }
+    }
+
+    size_t ConfigTransaction::commit()
+    {
+        std::vector<Change> changes;
+        changes.swap(changes_);
+        if (!errors_.empty())
+        {
+            return 0;
+        }
+        std::vector<size_t> changed;
+        {
+            MutexType::WriteLock lock(get_mutex());
+            changed = publish(changes);
+        }
+        notify(changes, changed);
+        return changed.size();
+    }
+
+    std::vector<size_t> ConfigTransaction::publish(const std::vector<Change> &changes)
+    {
+        std::vector<size_t> changed;
+        begin_publish();
+        for (size_t i = 0; i < changes.size(); i++)
+        {
+            //已经被更高优先级的来源覆盖的配置项跳过
+            if (changes[i].var->update_source(changes[i].source) &&
+                changes[i].var->apply_pending(changes[i].pending))
+            {
+                changed.push_back(i);
+            }
+        }
+        end_publish();
+        for (auto i : changed)
+        {
+            ConfigHistory::add(changes[i].var->get_id(), changes[i].pending);
+        }
+        ConfigHistory::push(get_generation());
+        return changed;
+    }
+
+    void ConfigTransaction::notify(const std::vector<Change> &changes, const std::vector<size_t> &changed)
+    {
+        //全部发布之后再通知,回调中看到的是事务完成后的状态
+        for (auto i : changed)
+        {
+            changes[i].var->notify_changed(changes[i].pending);
+        }
+    }
+
+    bool ConfigTransaction::rollback(uint64_t generation)
+    {
+        std::vector<Change> changes;
+        std::vector<size_t> changed;
+        {
+            //在发布锁内比较和发布,期间不会有其他发布插入
+            MutexType::WriteLock lock(get_mutex());
+            bool found = ConfigHistory::diff(generation, [&changes](uint32_t id, const std::shared_ptr<const void> &value)
+                                             {
+                                                 Change change;
+                                                 change.var = Config::lookup_base(id);
+                                                 change.pending = change.var->stage_erased(value);
+                                                 change.source = ConfigSource::RUNTIME;
+                                                 changes.push_back(change);
+                                             });
+            if (!found)
+            {
+                return false;
+            }
+            changed = publish(changes);
+        }
+        notify(changes, changed);
+        BLUESKY_LOG_INFO(BLUESKY_LOG_ROOT()) << "config rollback to generation " << generation
+                                             << ", " << changed.size() << " config changed";
+        return true;
+    }
+
+    struct ConfigHistoryData
+    {
+        struct Version
+        {
+            uint64_t generation;
+            ConfigHistory::Values values;
+        };
+        size_t capacity = 16;
+        //最新的值,等于versions的最后一个版本加上本次发布中已经记录的变化
+        ConfigHistory::Values latest;
+        //每个配置项第一次被修改之前的值
+        ConfigHistory::Values baseline;
+        bool dirty = false;
+        std::deque<Version> versions{Version{0, ConfigHistory::Values()}};
+    };
+
+    static ConfigHistoryData &get_history()
+    {
+        static ConfigHistoryData data;
+        return data;
+    }
+
+    void ConfigHistory::set_capacity(size_t capacity)
+    {
+        ConfigTransaction::MutexType::WriteLock lock(ConfigTransaction::get_mutex());
+        ConfigHistoryData &history = get_history();
+        history.capacity = std::max<size_t>(capacity, 1);
+        while (history.versions.size() > history.capacity)
+        {
+            history.versions.pop_front();
+        }
+    }
+
+    size_t ConfigHistory::get_capacity()
+    {
+        ConfigTransaction::MutexType::ReadLock lock(ConfigTransaction::get_mutex());
+        return get_history().capacity;
+    }
+
+    std::vector<uint64_t> ConfigHistory::get_generations()
+    {
+        ConfigTransaction::MutexType::ReadLock lock(ConfigTransaction::get_mutex());
+        std::vector<uint64_t> generations;
+        for (auto &version : get_history().versions)
+        {
+            generations.push_back(version.generation);
+        }
+        return generations;
+    }
+
+    void ConfigHistory::add(uint32_t id, const ConfigVarBase::Pending::Ptr &pending)
+    {
+        //没有注册的配置项无法通过编号找回,不记录
+        if (id == ConfigRegistry::npos)
+        {
+            return;
+        }
+        ConfigHistoryData &history = get_history();
+        if (!history.latest.count(id))
+        {
+            history.baseline = history.baseline.set(id, pending->get_old());
+        }
+        history.latest = history.latest.set(id, pending->get_new());
+        history.dirty = true;
+    }
+
+    void ConfigHistory::push(uint64_t generation)
+    {
+        ConfigHistoryData &history = get_history();
+        if (!history.dirty)
+        {
+            return;
+        }
+        history.dirty = false;
+        history.versions.push_back(ConfigHistoryData::Version{generation, history.latest});
+        while (history.versions.size() > history.capacity)
+        {
+            history.versions.pop_front();
+        }
+    }
+
+    bool ConfigHistory::diff(uint64_t generation, const std::function<void(uint32_t, const std::shared_ptr<const void> &)> &callback)
+    {
+        ConfigHistoryData &history = get_history();
+        if (generation < history.versions.front().generation || generation > ConfigTransaction::get_generation())
+        {
+            return false;
+        }
+        //generation时的状态是不晚于它的最后一个版本
+        auto iter = history.versions.rbegin();
+        while (iter->generation > generation)
+        {
+            ++iter;
+        }
+        //版本中的配置项只增不减,当前有而目标版本没有的配置项恢复为基线中的值
+        Values::diff(iter->values, history.latest, [&history, &callback](const uint32_t &id, const std::shared_ptr<const void> *old_value, const std::shared_ptr<const void> *new_value)
+                     { callback(id, old_value ? *old_value : *history.baseline.find(id)); });
+        return true;
+    }
+
+    //一次加载中所有校验失败的配置项合并输出
+    static void report_errors(const std::string &source, const ConfigTransaction &transaction)
+    {
+        std::stringstream ss;
+        ss << source << " rejected, " << transaction.get_errors().size() << " invalid config:";
+        for (auto &error : transaction.get_errors())
+        {
+            ss << std::endl
+               << "    " << error;
+        }
+        BLUESKY_LOG_ERROR(BLUESKY_LOG_ROOT()) << ss.str();
+    }
+
+    //找出所有键值对,作为一个事务发布
+    bool Config::load_from_yaml(const YAML::Node &root)
     {
         std::list<std::pair<std::string, const YAML::Node>> allNodes;
         list_all_member("", root, allNodes);
 
+        //list_all_member只接受小写的名称,这里不需要再转换
+        ConfigTransaction transaction(ConfigSource::FILE);
         for (auto &node : allNodes)
         {
-            std::string key = node.first;
+            const std::string &key = node.first;
             if (key.empty())
                 continue;
 
-            std::transform(key.begin(), key.end(), key.begin(), ::tolower);
             std::shared_ptr<ConfigVarBase> var = bluesky::Config::lookup_base(key);
 
             if (var)
             {
+                transaction.set_node(var, node.second);
+            }
+        }
+        if (transaction.has_error())
+        {
+            report_errors("Config load_from_yaml", transaction);
+            return false;
+        }
+        transaction.commit();
+        return true;
+    }
+    //配置文件的缓存信息
+    struct ConfigFileInfo
+    {
+        uint64_t mtime = 0; //修改时间(ns)
+        uint64_t size = 0;
+        uint64_t hash = 0;  //文件内容的哈希
+        std::list<std::pair<std::string, const YAML::Node>> nodes; //文件中的所有配置项
+    };
+
+    static std::map<std::string, ConfigFileInfo> &get_file_cache()
+    {
+        static std::map<std::string, ConfigFileInfo> files;
+        return files;
+    }
+
+    static Mutex &get_file_mutex()
+    {
+        static Mutex mutex;
+        return mutex;
+    }
+
+    //每个配置项最近一次从文件中设置的内容哈希
+    static std::map<std::string, uint64_t> &get_applied_hashes()
+    {
+        static std::map<std::string, uint64_t> hashes;
+        return hashes;
+    }
+
+    //需要重新解析的文件
+    struct ConfigFileLoad
+    {
+        std::string file;
+        uint64_t mtime = 0;
+        uint64_t size = 0;
+        uint64_t hash = 0;
+        std::string content;
+        YAML::Node root;
+        std::string error;
+        bool ok = false;
+    };
+
+    //最多使用4个线程并行解析
+    static void parse_files(std::vector<ConfigFileLoad> &loads)
+    {
+        std::atomic<size_t> next{0};
+        std::function<void()> parse = [&loads, &next]()
+        {
+            size_t i;
+            while ((i = next++) < loads.size())
+            {
+                try
+                {
+                    loads[i].root = YAML::Load(loads[i].content);
+                    loads[i].ok = true;
+                }
+                catch (std::exception &e)
+                {
+                    loads[i].error = e.what();
+                }
+            }
+        };
+        size_t count = std::min<size_t>(loads.size(), 4);
+        if (count <= 1)
+        {
+            parse();
+            return;
+        }
+        std::vector<Thread::Ptr> threads;
+        for (size_t i = 0; i < count; i++)
+        {
+            threads.push_back(Thread::Ptr(new Thread(parse, "config_parse_" + std::to_string(i))));
+        }
+        for (auto &thread : threads)
+        {
+            thread->join();
+        }
+    }
+
+    //同一个目录的不同写法("conf/"、"./conf")对应同一组缓存项,删除检测按目录前缀匹配缓存中的文件
+    static std::string normalize_dir(const std::string &path)
+    {
+        char buf[PATH_MAX];
+        if (realpath(path.c_str(), buf))
+        {
+            return buf;
+        }
+        std::string dir = path;
+        while (dir.size() > 1 && dir.back() == '/')
+        {
+            dir.pop_back();
+        }
+        return dir;
+    }
+
+    size_t Config::load_from_dir(const std::string &dir, bool force)
+    {
+        std::string path = normalize_dir(dir);
+        std::vector<std::string> files;
+        list_all_files(files, path, ".yml");
+        list_all_files(files, path, ".yaml");
+        std::sort(files.begin(), files.end());
+
+        Mutex::Lock lock(get_file_mutex());
+        std::map<std::string, ConfigFileInfo> &cache = get_file_cache();
+
+        //1. 根据修改时间、大小和内容哈希找出变化的文件
+        std::vector<ConfigFileLoad> loads;
+        for (auto &file : files)
+        {
+            struct stat st;
+            if (stat(file.c_str(), &st) != 0)
+            {
+                continue;
+            }
+            uint64_t mtime = (uint64_t)st.st_mtim.tv_sec * 1000000000ULL + st.st_mtim.tv_nsec;
+            auto iter = cache.find(file);
+            if (!force && iter != cache.end() && iter->second.mtime == mtime && iter->second.size == (uint64_t)st.st_size)
+            {
+                continue;
+            }
+            std::ifstream ifs(file);
+            if (!ifs)
+            {
+                BLUESKY_LOG_ERROR(BLUESKY_LOG_ROOT()) << "Config load_from_dir open file failed: " << file;
+                continue;
+            }
+            std::stringstream ss;
+            ss << ifs.rdbuf();
+            ConfigFileLoad load;
+            load.file = file;
+            load.mtime = mtime;
+            load.size = st.st_size;
+            load.content = ss.str();
+            load.hash = hash_fnv1a(load.content.data(), load.content.size());
+            if (!force && iter != cache.end() && iter->second.hash == load.hash)
+            {
+                //只是修改时间变化,内容没有变化
+                iter->second.mtime = mtime;
+                iter->second.size = load.size;
+                continue;
+            }
+            loads.push_back(load);
+        }
+
+        //已经删除的文件中的配置项需要重新确定以哪个文件为准
+        std::set<std::string> changed_keys;
+        for (auto iter = cache.begin(); iter != cache.end();)
+        {
+            if (iter->first.compare(0, path.size() + 1, path + "/") == 0 &&
+                !std::binary_search(files.begin(), files.end(), iter->first))
+            {
+                for (auto &node : iter->second.nodes)
+                {
+                    changed_keys.insert(node.first);
+                }
+                iter = cache.erase(iter);
+            }
+            else
+            {
+                ++iter;
+            }
+        }
+        if (loads.empty() && changed_keys.empty())
+        {
+            return 0;
+        }
+
+        //2. 并行解析
+        parse_files(loads);
+
+        size_t loaded = 0;
+        for (auto &load : loads)
+        {
+            if (!load.ok)
+            {
+                //解析失败的文件不更新缓存,下次加载时重试
+                BLUESKY_LOG_ERROR(BLUESKY_LOG_ROOT()) << "Config load_from_dir parse file failed: "
+                                                      << load.file << " " << load.error;
+                continue;
+            }
+            ConfigFileInfo &info = cache[load.file];
+            for (auto &node : info.nodes)
+            {
+                changed_keys.insert(node.first);
+            }
+            info.mtime = load.mtime;
+            info.size = load.size;
+            info.hash = load.hash;
+            info.nodes.clear();
+            list_all_member("", load.root, info.nodes);
+            for (auto &node : info.nodes)
+            {
+                changed_keys.insert(node.first);
+            }
+            ++loaded;
+        }
+
+        //3. 按路径顺序合并,同一个配置项以路径靠后的文件为准,只设置变化文件中出现过的配置项
+        //YAML::Node的赋值会修改被引用的节点,这里只保存指针
+        std::map<std::string, const YAML::Node *> merged;
+        for (auto &file : files)
+        {
+            auto iter = cache.find(file);
+            if (iter == cache.end())
+            {
+                continue;
+            }
+            for (auto &node : iter->second.nodes)
+            {
+                if (!node.first.empty() && changed_keys.count(node.first))
+                {
+                    merged[node.first] = &node.second;
+                }
+            }
+        }
+        //4. 与上一次从文件设置的内容比较,内容没有变化的配置项不重新设置,也就不会触发监听回调
+        //所有变化的配置项作为一个事务发布,提交成功之后才更新applied
+        std::map<std::string, uint64_t> &applied = get_applied_hashes();
+        std::map<std::string, uint64_t> hashes;
+        ConfigTransaction transaction(ConfigSource::FILE);
+        for (auto &node : merged)
+        {
+            std::shared_ptr<ConfigVarBase> var = lookup_base(node.first);
+            if (!var)
+            {
+                continue;
+            }
+            std::stringstream ss;
+            ss << *node.second;
+            std::string content = ss.str();
+            uint64_t hash = hash_fnv1a(content.data(), content.size());
+            auto iter = applied.find(node.first);
+            if (!force && iter != applied.end() && iter->second == hash)
+            {
+                continue;
+            }
+            hashes[node.first] = hash;
+            transaction.set_node(var, *node.second);
+        }
+        //从所有文件中删除的配置项恢复为默认值,之后被运行时修改或者有覆盖值的配置项保持不变
+        for (auto &key : changed_keys)
+        {
+            if (merged.count(key) || !applied.count(key))
+            {
+                continue;
+            }
+            std::shared_ptr<ConfigVarBase> var = lookup_base(key);
+            if (var && var->get_source() == ConfigSource::FILE)
+            {
+                transaction.reset(var);
+            }
+        }
+        if (transaction.has_error())
+        {
+            report_errors("Config load_from_dir " + path, transaction);
+            //丢弃本次读取的文件缓存,文件修正之后所有变化的配置项一起重新加载
+            for (auto &load : loads)
+            {
+                cache.erase(load.file);
+            }
+            return 0;
+        }
+        for (auto &key : changed_keys)
+        {
+            if (!merged.count(key))
+            {
+                applied.erase(key);
+            }
+        }
+        for (auto &hash : hashes)
+        {
+            applied[hash.first] = hash.second;
+        }
+        transaction.commit();
+        return loaded;
+    }
+
+    void Config::get_file_values(const std::string &dir, std::map<std::string, std::string> &values)
+    {
+        std::string path = normalize_dir(dir);
+        std::vector<std::string> files;
+        list_all_files(files, path, ".yml");
+        list_all_files(files, path, ".yaml");
+        std::sort(files.begin(), files.end());
+
+        Mutex::Lock lock(get_file_mutex());
+        std::map<std::string, ConfigFileInfo> &cache = get_file_cache();
+        for (auto &file : files)
+        {
+            auto iter = cache.find(file);
+            if (iter == cache.end())
+            {
+                continue;
+            }
+            for (auto &node : iter->second.nodes)
+            {
+                if (node.first.empty())
+                {
+                    continue;
+                }
                 if (node.second.IsScalar())
                 {
-                    var->fromString(node.second.Scalar());
+                    values[node.first] = node.second.Scalar();
                 }
                 else
                 {
                     std::stringstream ss;
                     ss << node.second;
-                    var->fromString(ss.str());
+                    values[node.first] = ss.str();
                 }
             }
         }
     }
-    std::shared_ptr<ConfigVarBase> Config::lookup_base(const std::string &name)
+
+    bool Config::load_overlays(int argc, char **argv, const std::string &prefix)
     {
-        MutexType::Lock lock(get_mutex());
-        auto iter = get_configs().find(name);
-        if (iter == get_configs().end())
+        //环境变量和命令行各扫描一遍,再按已定义的配置项逐个匹配
+        std::map<std::string, std::string> envs;
+        for (char **env = environ; env && *env; ++env)
+        {
+            const char *pos = strchr(*env, '=');
+            if (pos && strncmp(*env, prefix.c_str(), prefix.size()) == 0)
+            {
+                envs[std::string(*env, pos - *env)] = pos + 1;
+            }
+        }
+        std::map<std::string, std::string> args;
+        for (int i = 1; i < argc; i++)
+        {
+            const char *pos = strchr(argv[i], '=');
+            if (strncmp(argv[i], "--", 2) == 0 && pos)
+            {
+                std::string name(argv[i] + 2, pos - argv[i] - 2);
+                std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+                args[name] = pos + 1;
+            }
+        }
+
+        ConfigTransaction transaction(ConfigSource::ENV);
+        if (!envs.empty())
+        {
+            std::function<void(ConfigVarBase::Ptr)> cb = [&](ConfigVarBase::Ptr var)
+            {
+                std::string name = prefix + var->get_configname();
+                std::transform(name.begin() + prefix.size(), name.end(), name.begin() + prefix.size(), ::toupper);
+                std::replace(name.begin() + prefix.size(), name.end(), '.', '_');
+                auto iter = envs.find(name);
+                if (iter != envs.end())
+                {
+                    transaction.set_string(var, iter->second);
+                }
+            };
+            visit_configs(cb);
+        }
+        //命令行后暂存,同一个配置项以命令行为准
+        transaction.set_source(ConfigSource::ARGV);
+        for (auto &arg : args)
+        {
+            std::shared_ptr<ConfigVarBase> var = lookup_base(arg.first);
+            if (var)
+            {
+                transaction.set_string(var, arg.second);
+            }
+        }
+        if (transaction.has_error())
+        {
+            report_errors("Config load_overlays", transaction);
+            return false;
+        }
+        transaction.commit();
+        return true;
+    }
+
+    static void split_name(const std::string &name, std::vector<std::string> &segments)
+    {
+        size_t begin = 0;
+        while (begin <= name.size())
+        {
+            size_t end = name.find('.', begin);
+            if (end == std::string::npos)
+            {
+                end = name.size();
+            }
+            segments.push_back(name.substr(begin, end - begin));
+            begin = end + 1;
+        }
+    }
+
+    ConfigTrie::Ptr ConfigTrie::insert(const Ptr &root, const std::string &name, uint32_t id)
+    {
+        std::vector<std::string> segments;
+        split_name(name, segments);
+        return insert(root.get(), segments, 0, id);
+    }
+
+    ConfigTrie::Ptr ConfigTrie::insert(const ConfigTrie *node, const std::vector<std::string> &segments, size_t idx, uint32_t id)
+    {
+        std::shared_ptr<ConfigTrie> copy(node ? new ConfigTrie(*node) : new ConfigTrie);
+        if (idx == segments.size())
+        {
+            copy->id_ = id;
+            return copy;
+        }
+        auto iter = copy->children_.find(segments[idx]);
+        copy->children_[segments[idx]] = insert(iter == copy->children_.end() ? nullptr : iter->second.get(),
+                                                segments, idx + 1, id);
+        return copy;
+    }
+
+    ConfigTrie::Ptr ConfigTrie::find(const Ptr &root, const std::string &prefix)
+    {
+        if (prefix.empty())
+        {
+            return root;
+        }
+        std::vector<std::string> segments;
+        split_name(prefix, segments);
+        Ptr node = root;
+        for (auto &segment : segments)
+        {
+            if (!node)
+            {
+                break;
+            }
+            auto iter = node->children_.find(segment);
+            node = iter == node->children_.end() ? nullptr : iter->second;
+        }
+        return node;
+    }
+
+    void ConfigTrie::visit(const std::function<void(uint32_t)> &callback) const
+    {
+        if (id_ != npos)
+        {
+            callback(id_);
+        }
+        for (auto &child : children_)
+        {
+            child.second->visit(callback);
+        }
+    }
+
+    //去掉末尾的".*"或者'.',与配置名称一样转换为小写
+    static std::string normalize_prefix(const std::string &prefix)
+    {
+        std::string result = prefix;
+        std::transform(result.begin(), result.end(), result.begin(), ::tolower);
+        if (result.size() >= 1 && result.back() == '*')
+        {
+            result.pop_back();
+        }
+        if (result.size() >= 1 && result.back() == '.')
+        {
+            result.pop_back();
+        }
+        return result;
+    }
+
+    void Config::visit_prefix(const std::string &prefix, const std::function<void(ConfigVarBase::Ptr)> &callback)
+    {
+        ConfigStaticList::register_all();
+        ConfigRegistry &registry = get_registry();
+        ConfigTrie::Ptr node = ConfigTrie::find(registry.get_trie(), normalize_prefix(prefix));
+        if (!node)
+        {
+            return;
+        }
+        node->visit([&registry, &callback](uint32_t id)
+                    {
+                        ConfigVarBase::Ptr var = registry.get(id);
+                        if (var)
+                        {
+                            callback(var);
+                        }
+                    });
+    }
+
+    //前缀树的子树转换成嵌套的YAML节点,叶子节点为配置项的值
+    static YAML::Node trie_to_node(ConfigRegistry &registry, const ConfigTrie::Ptr &node)
+    {
+        if (node->get_children().empty())
+        {
+            ConfigVarBase::Ptr var = registry.get(node->get_id());
+            return var ? var->toNode() : YAML::Node();
+        }
+        YAML::Node result(YAML::NodeType::Map);
+        for (auto &child : node->get_children())
+        {
+            result[child.first] = trie_to_node(registry, child.second);
+        }
+        return result;
+    }
+
+    static YAML::Node dump_node(ConfigRegistry &registry, const std::string &prefix)
+    {
+        std::string name = normalize_prefix(prefix);
+        ConfigTrie::Ptr node = ConfigTrie::find(registry.get_trie(), name);
+        if (!node)
+        {
+            return YAML::Node(YAML::NodeType::Map);
+        }
+        YAML::Node result = trie_to_node(registry, node);
+        if (name.empty())
+        {
+            return result;
+        }
+        //按前缀的分段从内向外套上外层的map,YAML::Node赋值会修改被引用的节点,这里用reset
+        std::vector<std::string> segments;
+        split_name(name, segments);
+        for (auto iter = segments.rbegin(); iter != segments.rend(); ++iter)
+        {
+            YAML::Node outer(YAML::NodeType::Map);
+            outer[*iter] = result;
+            result.reset(outer);
+        }
+        return result;
+    }
+
+    static void json_string(const std::string &str, std::ostream &os)
+    {
+        os << '"';
+        for (unsigned char c : str)
+        {
+            switch (c)
+            {
+            case '"':
+                os << "\\\"";
+                break;
+            case '\\':
+                os << "\\\\";
+                break;
+            case '\n':
+                os << "\\n";
+                break;
+            case '\t':
+                os << "\\t";
+                break;
+            default:
+                if (c < 0x20)
+                {
+                    char buf[8];
+                    snprintf(buf, sizeof(buf), "\\u%04x", c);
+                    os << buf;
+                }
+                else
+                {
+                    os << c;
+                }
+            }
+        }
+        os << '"';
+    }
+
+    //没有加引号的数字、true/false/null原样输出,其它标量作为字符串
+    static bool json_literal(const YAML::Node &node)
+    {
+        const std::string &str = node.Scalar();
+        if (node.Tag() == "!" || str.empty())
+        {
+            return false;
+        }
+        if (str == "true" || str == "false" || str == "null")
+        {
+            return true;
+        }
+        size_t i = str[0] == '-' ? 1 : 0;
+        if (i >= str.size() || !isdigit((unsigned char)str[i]))
+        {
+            return false;
+        }
+        char *end = nullptr;
+        strtod(str.c_str(), &end);
+        return *end == '\0';
+    }
+
+    static void node_to_json(const YAML::Node &node, std::ostream &os)
+    {
+        switch (node.Type())
+        {
+        case YAML::NodeType::Map:
+        {
+            os << '{';
+            bool first = true;
+            for (auto iter = node.begin(); iter != node.end(); ++iter)
+            {
+                os << (first ? "" : ",");
+                first = false;
+                json_string(iter->first.Scalar(), os);
+                os << ':';
+                node_to_json(iter->second, os);
+            }
+            os << '}';
+            break;
+        }
+        case YAML::NodeType::Sequence:
+        {
+            os << '[';
+            for (size_t i = 0; i < node.size(); i++)
+            {
+                os << (i ? "," : "");
+                node_to_json(node[i], os);
+            }
+            os << ']';
+            break;
+        }
+        case YAML::NodeType::Scalar:
+            if (json_literal(node))
+            {
+                os << node.Scalar();
+            }
+            else
+            {
+                json_string(node.Scalar(), os);
+            }
+            break;
+        default:
+            os << "null";
+        }
+    }
+
+    std::string Config::dump_yaml(const std::string &prefix)
+    {
+        ConfigStaticList::register_all();
+        std::stringstream ss;
+        ss << dump_node(get_registry(), prefix);
+        return ss.str();
+    }
+
+    std::string Config::dump_json(const std::string &prefix)
+    {
+        ConfigStaticList::register_all();
+        std::stringstream ss;
+        node_to_json(dump_node(get_registry(), prefix), ss);
+        return ss.str();
+    }
+
+    ConfigNotifier &ConfigNotifier::get_instance()
+    {
+        return Singleton<ConfigNotifier>::get_instance();
+    }
+
+    static void stop_notifier_at_exit()
+    {
+        ConfigNotifier::get_instance().stop();
+    }
+
+    ConfigNotifier::~ConfigNotifier()
+    {
+        stop();
+    }
+
+    void ConfigNotifier::post(ConfigVarBase::Ptr var)
+    {
+        bool stopped;
+        {
+            MutexType::Lock lock(mutex_);
+            stopped = stopping_;
+            if (!stopped)
+            {
+                if (!thread_)
+                {
+                    thread_.reset(new Thread(std::bind(&ConfigNotifier::run, this), "config_notify"));
+                    atexit(&stop_notifier_at_exit);
+                }
+                queue_.push_back([var]()
+                                 { var->notify_pending(); });
+            }
+        }
+        if (stopped)
+        {
+            var->notify_pending();
+            return;
+        }
+        semaphore_.post();
+    }
+
+    void ConfigNotifier::stop()
+    {
+        Thread::Ptr thread;
+        {
+            MutexType::Lock lock(mutex_);
+            if (stopping_)
+            {
+                return;
+            }
+            stopping_ = true;
+            thread.swap(thread_);
+        }
+        if (!thread)
+        {
+            return;
+        }
+        semaphore_.post();
+        //在监听回调中调用exit时不能join自己,通知线程处理完队列后自行退出
+        if (Thread::get_this() != thread.get())
+        {
+            thread->join();
+        }
+    }
+
+    void ConfigNotifier::flush()
+    {
+        Semaphore done;
+        {
+            MutexType::Lock lock(mutex_);
+            if (!thread_)
+            {
+                return;
+            }
+            queue_.push_back([&done]()
+                             { done.post(); });
+        }
+        semaphore_.post();
+        done.wait();
+    }
+
+    void ConfigNotifier::run()
+    {
+        while (true)
+        {
+            semaphore_.wait();
+            std::function<void()> task;
+            {
+                MutexType::Lock lock(mutex_);
+                if (queue_.empty())
+                {
+                    if (stopping_)
+                    {
+                        break;
+                    }
+                    continue;
+                }
+                task.swap(queue_.front());
+                queue_.pop_front();
+            }
+            task();
+        }
+    }
+
+    ConfigRegistry::ConfigRegistry()
+    {
+        Table *table = new Table;
+        table->mask = 255;
+        table->slots = new std::atomic<uint64_t>[table->mask + 1]();
+        table_.store(table);
+        for (auto &segment : segments_)
+        {
+            segment.store(nullptr);
+        }
+    }
+
+    uint32_t ConfigRegistry::hash(const std::string &name)
+    {
+        uint64_t hash = hash_fnv1a(name.data(), name.size());
+        return (uint32_t)(hash ^ (hash >> 32));
+    }
+
+    void ConfigRegistry::insert(Table *table, uint64_t value)
+    {
+        size_t pos = (value >> 32) & table->mask;
+        while (table->slots[pos].load(std::memory_order_relaxed))
+        {
+            pos = (pos + 1) & table->mask;
+        }
+        table->slots[pos].store(value, std::memory_order_release);
+    }
+
+    ConfigVarBase::Ptr *ConfigRegistry::slot(uint32_t id) const
+    {
+        uint32_t n = id + 1;
+        int seg = 31 - __builtin_clz(n);
+        ConfigVarBase::Ptr *segment = segments_[seg].load(std::memory_order_acquire);
+        return segment ? &segment[n - (1u << seg)] : nullptr;
+    }
+
+    uint32_t ConfigRegistry::find(const std::string &name) const
+    {
+        uint32_t h = hash(name);
+        Table *table = table_.load(std::memory_order_acquire);
+        size_t pos = h & table->mask;
+        while (true)
+        {
+            uint64_t value = table->slots[pos].load(std::memory_order_acquire);
+            if (!value)
+            {
+                return npos;
+            }
+            if ((uint32_t)(value >> 32) == h)
+            {
+                uint32_t id = (uint32_t)value - 1;
+                ConfigVarBase::Ptr *var = slot(id);
+                if (var && (*var)->get_configname() == name)
+                {
+                    return id;
+                }
+            }
+            pos = (pos + 1) & table->mask;
+        }
+    }
+
+    ConfigVarBase::Ptr ConfigRegistry::get(uint32_t id) const
+    {
+        if (id >= size())
         {
             return nullptr;
         }
-        return iter->second;
+        ConfigVarBase::Ptr *var = slot(id);
+        return var ? *var : nullptr;
     }
 
-    void Config::visit_configs(std::function<void(ConfigVarBase::Ptr)>& callback)
+    uint32_t ConfigRegistry::add(ConfigVarBase::Ptr var)
     {
-        MutexType::Lock lock(get_mutex());
-        ConfigVarMap& configs=get_configs();
-        for(auto iter=configs.begin(); iter!=configs.end();iter++){
-            callback(iter->second);
+        uint32_t id = size_.load(std::memory_order_relaxed);
+        uint32_t n = id + 1;
+        int seg = 31 - __builtin_clz(n);
+        if (!segments_[seg].load(std::memory_order_relaxed))
+        {
+            segments_[seg].store(new ConfigVarBase::Ptr[1u << seg], std::memory_order_release);
         }
+        var->id_ = id;
+        *slot(id) = var;
+        size_.store(id + 1, std::memory_order_release);
 
+        const std::string &name = var->get_configname();
+        std::atomic_store(&trie_, ConfigTrie::insert(std::atomic_load(&trie_), name, id));
+        uint32_t h = hash(name);
+        uint64_t value = ((uint64_t)h << 32) | (uint64_t)(id + 1);
+        Table *table = table_.load(std::memory_order_relaxed);
+        //同名配置项已存在(类型不同):名称改为指向新的配置项
+        for (size_t pos = h & table->mask;; pos = (pos + 1) & table->mask)
+        {
+            uint64_t old = table->slots[pos].load(std::memory_order_relaxed);
+            if (!old)
+            {
+                break;
+            }
+            if ((uint32_t)(old >> 32) == h && (*slot((uint32_t)old - 1))->get_configname() == name)
+            {
+                table->slots[pos].store(value, std::memory_order_release);
+                return id;
+            }
+        }
+        //负载因子超过1/2时扩容,新表构造完成后再发布
+        if ((used_ + 1) * 2 > table->mask + 1)
+        {
+            Table *bigger = new Table;
+            bigger->mask = table->mask * 2 + 1;
+            bigger->slots = new std::atomic<uint64_t>[bigger->mask + 1]();
+            for (size_t i = 0; i <= table->mask; i++)
+            {
+                uint64_t old = table->slots[i].load(std::memory_order_relaxed);
+                if (old)
+                {
+                    insert(bigger, old);
+                }
+            }
+            table_.store(bigger, std::memory_order_release);
+            retired_.push_back(table);
+            table = bigger;
+        }
+        insert(table, value);
+        ++used_;
+        return id;
+    }
+
+    //常量初始化,早于所有编译单元的动态初始化
+    std::atomic<ConfigStaticList::Entry *> ConfigStaticList::head_{nullptr};
+
+    void ConfigStaticList::push(Entry *entry)
+    {
+        Entry *head = head_.load(std::memory_order_relaxed);
+        do
+        {
+            entry->next = head;
+        } while (!head_.compare_exchange_weak(head, entry, std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    void ConfigStaticList::register_all()
+    {
+        if (!head_.load(std::memory_order_acquire))
+        {
+            return;
+        }
+        std::vector<ConfigVarBase::Ptr> invalid;
+        std::vector<ConfigVarBase::Ptr> conflicts;
+        {
+            Config::MutexType::Lock lock(Config::get_mutex());
+            ConfigRegistry &registry = Config::get_registry();
+            //全部注册完成之后才清空链表头,其他线程看到链表为空时注册一定已经完成
+            Entry *done = nullptr;
+            while (true)
+            {
+                Entry *head = head_.load(std::memory_order_acquire);
+                std::vector<Entry *> entries;
+                for (Entry *entry = head; entry != done; entry = entry->next)
+                {
+                    entries.push_back(entry);
+                }
+                //链表是后进先出,按定义顺序注册
+                for (auto iter = entries.rbegin(); iter != entries.rend(); ++iter)
+                {
+                    ConfigVarBase::Ptr var;
+                    var.swap((*iter)->var);
+                    const std::string &name = var->get_configname();
+                    if (name.empty() || name.find_first_not_of("abcdefghijklmnopqrstuvwxyz._0123456789") != std::string::npos)
+                    {
+                        invalid.push_back(var);
+                        continue;
+                    }
+                    if (registry.find(name) != ConfigRegistry::npos)
+                    {
+                        conflicts.push_back(var);
+                    }
+                    registry.add(var);
+                }
+                if (head_.compare_exchange_strong(head, nullptr, std::memory_order_acq_rel))
+                {
+                    break;
+                }
+                done = head;
+            }
+        }
+        //日志在锁外输出
+        for (auto &var : invalid)
+        {
+            BLUESKY_LOG_ERROR(BLUESKY_LOG_ROOT()) << "static config name invalid: " << var->get_configname();
+        }
+        for (auto &var : conflicts)
+        {
+            BLUESKY_LOG_ERROR(BLUESKY_LOG_ROOT()) << "static config name=" << var->get_configname()
+                                                  << " already defined, replaced by type=" << var->get_typename();
+        }
+    }
+
+    std::shared_ptr<ConfigVarBase> Config::lookup_base(const std::string &name)
+    {
+        ConfigStaticList::register_all();
+        ConfigRegistry &registry = get_registry();
+        return registry.get(registry.find(name));
+    }
+
+    std::shared_ptr<ConfigVarBase> Config::lookup_base(uint32_t id)
+    {
+        ConfigStaticList::register_all();
+        return get_registry().get(id);
+    }
+
+    uint32_t Config::get_id(const std::string &name)
+    {
+        ConfigStaticList::register_all();
+        return get_registry().find(name);
+    }
+
+    void Config::visit_configs(std::function<void(ConfigVarBase::Ptr)>& callback)
+    {
+        ConfigStaticList::register_all();
+        ConfigRegistry &registry = get_registry();
+        uint32_t size = registry.size();
+        for (uint32_t id = 0; id < size; id++)
+        {
+            ConfigVarBase::Ptr var = registry.get(id);
+            //被同名配置项替换掉的不再访问
+            if (var && registry.find(var->get_configname()) == id)
+            {
+                callback(var);
+            }
+        }
     }
 
 } //end of namespace
@@ -2,6 +2,7 @@
 #define __BLUESKY_CONFIG_H__
 
 #include "bluesky/log.h"
+#include "bluesky/persistent_map.h"
 #include <boost/lexical_cast.hpp>
 #include <yaml-cpp/yaml.h>
 #include <memory>
@@ -10,14 +11,38 @@
 #include <string>
 #include <exception>
 #include <list>
+#include <deque>
 #include <map>
 #include <set>
 #include <functional>
 #include <unordered_map>
 #include <unordered_set>
+#include <atomic>
+#include <algorithm>
+#include <type_traits>
+#include <string.h>
+#include <sched.h>
 
 namespace bluesky
 {
+    /* 配置值的来源,覆盖的优先级从低到高:默认值 < 配置文件 < 环境变量 < 命令行。
+     * 环境变量或者命令行设置过的配置项,之后从配置文件加载的值不再生效;
+     * 程序运行时通过set_value/fromString设置的值(RUNTIME)总是生效
+     */
+    class ConfigSource
+    {
+    public:
+        enum Type
+        {
+            DEFAULT = 0,
+            FILE = 1,
+            ENV = 2,
+            ARGV = 3,
+            RUNTIME = 4
+        };
+        static const char *to_string(Type type);
+    };
+
     /* 配置基类:定义配置项的基础接口
  * 基础属性：
  *      配置名称(get_configname)
@@ -26,7 +51,7 @@ namespace bluesky
  *      反序列化(from_string)
  *      具体的参数类型名称(get_typename)
  */
-    class ConfigVarBase
+    class ConfigVarBase : public std::enable_shared_from_this<ConfigVarBase>
     {
     public:
         typedef std::shared_ptr<ConfigVarBase> Ptr;
@@ -40,15 +65,147 @@ namespace bluesky
         virtual ~ConfigVarBase() {}
 
         const std::string &get_configname() const { return name_; }
+        //注册时分配的配置项编号,可以通过Config::lookup_base(id)直接取得配置项
+        uint32_t get_id() const { return id_; }
         const std::string &get_description() const { return description_; }
 
         virtual std::string toString() = 0;
+        //转换成YAML节点,默认解析toString的结果
+        virtual YAML::Node toNode()
+        {
+            return YAML::Load(toString());
+        }
+        //转换或者校验失败时返回false,配置项保持原值
         virtual bool fromString(const std::string &val) = 0;
+        //从YAML节点加载,默认把节点转成字符串后调用fromString
+        virtual bool fromNode(const YAML::Node &node)
+        {
+            if (node.IsScalar())
+            {
+                return fromString(node.Scalar());
+            }
+            std::stringstream ss;
+            ss << node;
+            return fromString(ss.str());
+        }
         virtual std::string get_typename() const = 0;
 
+        /* 异步通知:变更回调在配置通知线程(ConfigNotifier)中执行,不阻塞set_value的调用方;
+         * 回调执行之前的多次变更合并成一次,参数为合并前的旧值和最新的值
+         */
+        void set_async_notify(bool value) { asyncNotify_ = value; }
+        bool is_async_notify() const { return asyncNotify_; }
+        //由ConfigNotifier调用,执行合并后的变更回调
+        virtual void notify_pending() = 0;
+
+        //二进制快照使用:没有二进制表示的类型返回false,改用toString/fromString
+        virtual bool toBinary(std::string &out) { return false; }
+        virtual bool fromBinary(const char *data, size_t size) { return false; }
+
+        //修改后需要重启才能完全生效的配置项,运行时的修改仍然会发布,同时输出警告
+        bool is_restart_required() const { return restartRequired_; }
+        //当前值的来源
+        ConfigSource::Type get_source() const { return (ConfigSource::Type)source_.load(); }
+
+        /* 事务使用的两阶段接口,见ConfigTransaction
+         * stage_*: 类型转换并按ConfigRule校验,得到待发布的新值;失败返回nullptr并设置error,不修改配置项
+         * apply_pending: 在发布锁内调用,原子替换为新值,值没有变化返回false
+         * notify_changed: 发布完成后在锁外调用,执行或者投递变更回调
+         */
+        class Pending
+        {
+        public:
+            typedef std::shared_ptr<Pending> Ptr;
+            virtual ~Pending() {}
+            //发布前后的值快照(类型擦除),apply_pending返回true之后有效,供ConfigHistory记录
+            virtual std::shared_ptr<const void> get_old() const = 0;
+            virtual std::shared_ptr<const void> get_new() const = 0;
+        };
+        virtual Pending::Ptr stage_string(const std::string &val, std::string &error) = 0;
+        virtual Pending::Ptr stage_node(const YAML::Node &node, std::string &error)
+        {
+            if (node.IsScalar())
+            {
+                return stage_string(node.Scalar(), error);
+            }
+            std::stringstream ss;
+            ss << node;
+            return stage_string(ss.str(), error);
+        }
+        //二进制快照使用,没有二进制表示的类型返回nullptr
+        virtual Pending::Ptr stage_binary(const char *data, size_t size, std::string &error)
+        {
+            error = "no binary representation";
+            return nullptr;
+        }
+        virtual bool apply_pending(const Pending::Ptr &pending) = 0;
+        virtual void notify_changed(const Pending::Ptr &pending) = 0;
+        //回滚使用:以历史中保存的值快照作为新值,这个值发布时已经校验过,不再经过ConfigRule
+        virtual Pending::Ptr stage_erased(const std::shared_ptr<const void> &value) = 0;
+        //注册时的默认值快照(类型擦除),配置项从所有配置文件中删除之后用来恢复
+        virtual std::shared_ptr<const void> get_default() const = 0;
+
+    protected:
+        friend class ConfigTransaction;
+        /* 在发布锁内调用,记录新值的来源;
+         * 来源的优先级低于已经生效的环境变量/命令行覆盖值时返回false,这个新值不发布
+         */
+        bool update_source(ConfigSource::Type source)
+        {
+            if (source != ConfigSource::RUNTIME && source < overlay_)
+            {
+                return false;
+            }
+            source_ = source;
+            if ((source == ConfigSource::ENV || source == ConfigSource::ARGV) && source > overlay_)
+            {
+                overlay_ = source;
+            }
+            return true;
+        }
+
+    protected:
+        std::atomic<bool> restartRequired_{false};
+
     private:
+        friend class ConfigRegistry;
         std::string name_;
         std::string description_;
+        uint32_t id_ = (uint32_t)-1;
+        std::atomic<bool> asyncNotify_{false};
+        std::atomic<int> source_{ConfigSource::DEFAULT};
+        //已经生效的最高优先级覆盖来源(ENV/ARGV),没有时为DEFAULT
+        std::atomic<int> overlay_{ConfigSource::DEFAULT};
+    };
+
+    //配置通知线程:执行异步通知模式下的变更回调,第一次使用时启动
+    class ConfigNotifier
+    {
+    public:
+        typedef Mutex MutexType;
+
+        static ConfigNotifier &get_instance();
+        ~ConfigNotifier();
+
+        //配置项有待通知的变更;停止之后在调用线程中直接执行
+        void post(ConfigVarBase::Ptr var);
+        //等待已经提交的通知全部执行完
+        void flush();
+        /* 停止通知线程:执行完已经提交的通知之后退出并join。
+         * 通知线程启动时注册atexit,进程退出时在其之前构造的静态配置项、日志器析构之前停止,
+         * 不会在它们析构的同时执行监听回调
+         */
+        void stop();
+
+    private:
+        void run();
+
+    private:
+        std::deque<std::function<void()>> queue_;
+        MutexType mutex_;
+        Semaphore semaphore_;
+        Thread::Ptr thread_;
+        bool stopping_ = false;
     };
 
     //F:源类型 T:目标类型
@@ -62,340 +219,1442 @@ namespace bluesky
         }
     };
 
+    /* YAML::Node与T之间的直接转换
+     * 容器类型逐个转换子节点,不会把子节点重新序列化成字符串再解析,加载嵌套配置的开销与节点数成线性关系。
+     * 默认实现退化为字符串转换(LexicalCast),自定义类型可以特化FromNode/ToNode来避免这一次往返
+     */
     template <class T>
-    class LexicalCast<std::string, std::vector<T>>
+    class FromNode
     {
     public:
-        std::vector<T> operator()(const std::string &v)
+        T operator()(const YAML::Node &node)
         {
-            YAML::Node node = YAML::Load(v);
-            typename std::vector<T> vec;
-            std::stringstream ss;
-            for (auto i = 0; i < node.size(); i++)
+            if (node.IsScalar())
             {
-                ss.str("");
-                ss << node[i];
-                vec.push_back(LexicalCast<std::string, T>()(ss.str()));
+                return LexicalCast<std::string, T>()(node.Scalar());
             }
+            std::stringstream ss;
+            ss << node;
+            return LexicalCast<std::string, T>()(ss.str());
         }
     };
 
     template <class T>
-    class LexicalCast<std::vector<T>, std::string>
+    class ToNode
     {
     public:
-        std::string operator()(const std::vector<T> &v)
+        YAML::Node operator()(const T &v)
         {
-            YAML::Node node;
-            for (auto &vv : v)
-            {
-                node.push_back(YAML::Load(LexicalCast<T, std::string>()(vv)));
-            }
-            std::stringstream ss;
-            ss << node;
-            return ss.str();
+            return convert(v, std::is_arithmetic<T>());
+        }
+
+    private:
+        //算术类型的字符串一定是标量,直接构造节点,不需要再解析一次
+        YAML::Node convert(const T &v, std::true_type)
+        {
+            return YAML::Node(LexicalCast<T, std::string>()(v));
+        }
+
+        YAML::Node convert(const T &v, std::false_type)
+        {
+            return YAML::Load(LexicalCast<T, std::string>()(v));
         }
     };
 
-    template <class T>
-    class LexicalCast<std::string, std::list<T>>
+    template <>
+    class ToNode<std::string>
     {
     public:
-        std::list<T> operator()(const std::string &v)
+        YAML::Node operator()(const std::string &v)
         {
-            YAML::Node node = YAML::Load(v);
-            typename std::list<T> lst;
-            std::stringstream ss;
-            for (auto i = 0; i < node.size(); i++)
-            {
-                ss.str("");
-                ss << node[i];
-                lst.push_back(LexicalCast<std::string, T>()(ss.str()));
-            }
-            return lst;
+            //与加了引号的标量一样标记为字符串,导出JSON时不会把"123"当成数字
+            YAML::Node node(v);
+            node.SetTag("!");
+            return node;
         }
     };
 
-    template<class T>
-    class LexicalCast<std::list<T>, std::string>
+    template <class T>
+    class FromNode<std::vector<T>>
     {
-        public:
-            std::string operator()(const std::list<T> &v){
-                YAML::Node node;
-                for(auto& i:v){
-                    node.push_back(YAML::Load(LexicalCast<T, std::string>()(i)));
-                }
-                std::stringstream ss;
-                ss << node;
-                return ss.str();
+    public:
+        std::vector<T> operator()(const YAML::Node &node)
+        {
+            std::vector<T> result;
+            for (size_t i = 0; i < node.size(); i++)
+            {
+                result.push_back(FromNode<T>()(node[i]));
             }
+            return result;
+        }
     };
 
-    template<class T>
-    class LexicalCast<std::string, std::set<T>>
+    template <class T>
+    class ToNode<std::vector<T>>
     {
-        public:
-            std::set<T> operator()(const std::string& v){
-                YAML::Node node = YAML::Load(v);
-                typename std::set<T> st;
-                std::stringstream ss;
-                for (auto i = 0; i < node.size();i++){
-                    ss.str("");
-                    ss << node[i];
-                    st.insert(LexicalCast<std::string, T>()(ss.str()));
-                }
-                return st;
+    public:
+        YAML::Node operator()(const std::vector<T> &v)
+        {
+            YAML::Node node(YAML::NodeType::Sequence);
+            for (auto &i : v)
+            {
+                node.push_back(ToNode<T>()(i));
             }
+            return node;
+        }
     };
 
-    template<class T>
-    class LexicalCast<std::set<T>, std::string>
+    template <class T>
+    class FromNode<std::list<T>>
     {
-        public:
-            std::string operator()(const std::set<T>& v){
-                YAML::Node node;
-                for (auto& i:v){
-                    node.push_back(YAML::Load(LexicalCast<T, std::string>()(i)));
-                }
-                std::stringstream ss;
-                ss << node;
-                return ss.str();
+    public:
+        std::list<T> operator()(const YAML::Node &node)
+        {
+            std::list<T> result;
+            for (size_t i = 0; i < node.size(); i++)
+            {
+                result.push_back(FromNode<T>()(node[i]));
             }
+            return result;
+        }
     };
 
-    template<class T>
-    class LexicalCast<std::string, std::unordered_set<T>>
+    template <class T>
+    class ToNode<std::list<T>>
     {
-        public:
-        std::unordered_set<T> operator()(const std::string& v){
-            YAML::Node node = YAML::Load(v);
-            std::unordered_set<T> unst;
-            std::stringstream ss;
-            for (auto i = 0; i < node.size();i++){
-                ss.str("");
-                ss << node[i];
-                unst.push_back(LexicalCast<std::string, T>()(ss.str()));
+    public:
+        YAML::Node operator()(const std::list<T> &v)
+        {
+            YAML::Node node(YAML::NodeType::Sequence);
+            for (auto &i : v)
+            {
+                node.push_back(ToNode<T>()(i));
             }
-            return unst;
+            return node;
         }
     };
 
-    template<class T>
-    class LexicalCast<std::unordered_set<T>, std::string>
+    template <class T>
+    class FromNode<std::set<T>>
     {
-        public:
-        std::string operator()(const std::unordered_set<T>& v){
-            YAML::Node node;
-            for(auto& i:v){
-                node.push_back(YAML::Load(LexicalCast<T, std::string>()(i)));
+    public:
+        std::set<T> operator()(const YAML::Node &node)
+        {
+            std::set<T> result;
+            for (size_t i = 0; i < node.size(); i++)
+            {
+                result.insert(FromNode<T>()(node[i]));
             }
-            std::stringstream ss;
-            ss << node;
-            return ss.str();
+            return result;
         }
     };
 
-    template<class T>
-    class LexicalCast<std::string, std::map<std::string,T>>
+    template <class T>
+    class ToNode<std::set<T>>
     {
-        public:
-        std::map<std::string,T> operator()(const std::string& v){
-            YAML::Node node = YAML::Load(v);
-            std::map<std::string, T> mp;
-            std::stringstream ss;
-            for (auto iter = node.begin(); iter != node.end();iter++)
+    public:
+        YAML::Node operator()(const std::set<T> &v)
+        {
+            YAML::Node node(YAML::NodeType::Sequence);
+            for (auto &i : v)
             {
-                ss.str("");
-                ss << iter->second;
-                mp.insert(std::make_pair(iter->first.Scalar(),
-                                         LexicalCast<std::string, T>()(ss.str())));
+                node.push_back(ToNode<T>()(i));
             }
-            return mp;
+            return node;
         }
     };
 
-    template<class T>
-    class LexicalCast<std::map<std::string,T>, std::string>
+    template <class T>
+    class FromNode<std::unordered_set<T>>
     {
-        public:
-        std::string operator()(const std::map<std::string,T>& v){
-            YAML::Node node;
-            for(auto& [key,value]:v){
-                node[key] = YAML::Load(LexicalCast<T, std::string>()(value));
+    public:
+        std::unordered_set<T> operator()(const YAML::Node &node)
+        {
+            std::unordered_set<T> result;
+            for (size_t i = 0; i < node.size(); i++)
+            {
+                result.insert(FromNode<T>()(node[i]));
             }
-            std::stringstream ss;
-            ss << node;
-            return ss.str();
+            return result;
         }
     };
 
- template<class T>
-    class LexicalCast<std::string, std::unordered_map<std::string,T> >
+    template <class T>
+    class ToNode<std::unordered_set<T>>
     {
-        public:
-        std::unordered_map<std::string,T> operator()(const std::string& v){
-            YAML::Node node = YAML::Load(v);
-            std::unordered_map<std::string, T> mp;
-            std::stringstream ss;
-            for (auto iter = node.begin(); iter != node.end();iter++)
+    public:
+        YAML::Node operator()(const std::unordered_set<T> &v)
+        {
+            YAML::Node node(YAML::NodeType::Sequence);
+            for (auto &i : v)
             {
-                ss.str("");
-                ss << iter->second;
-                mp.insert(std::make_pair(iter->first.Scalar,
-                                         LexicalCast<std::string, T>()(ss.str())));
+                node.push_back(ToNode<T>()(i));
             }
-            return mp;
+            return node;
         }
     };
 
-    template<class T>
-    class LexicalCast<std::unordered_map<std::string,T>, std::string>
+    template <class T>
+    class FromNode<std::map<std::string, T>>
     {
-        public:
-        std::string operator()(const std::unordered_map<std::string,T>& v){
-            YAML::Node node;
-            for(auto& [key,value]:v){
-                node[key] = YAML::Load(LexicalCast<T, std::string>()(value));
+    public:
+        std::map<std::string, T> operator()(const YAML::Node &node)
+        {
+            std::map<std::string, T> result;
+            for (auto iter = node.begin(); iter != node.end(); iter++)
+            {
+                result.insert(std::make_pair(iter->first.Scalar(), FromNode<T>()(iter->second)));
             }
-            std::stringstream ss;
-            ss << node;
-            return ss.str();
+            return result;
         }
     };
-    /* T: 参数类型
-     * FromStr: 将string转换为T类型
-     * ToStr: 将T类型转换为string
-     */
-    template <class T,
-              class FromStr = LexicalCast<std::string, T>,
-              class ToStr = LexicalCast<T, std::string>>
-    class ConfigVar : public ConfigVarBase
+
+    template <class T>
+    class ToNode<std::map<std::string, T>>
     {
     public:
-        typedef std::shared_ptr<ConfigVar> Ptr;
-        typedef std::function<void(const T &old_value, const T &new_value)> on_change_cb;
-        typedef Mutex MutexType;   
-    
-        ConfigVar(const std::string &name, const T &value, const std::string &description = "")
-            : ConfigVarBase(name, description), value_(value)
+        YAML::Node operator()(const std::map<std::string, T> &v)
         {
+            //键不会重复,force_insert不需要逐个比较已有的键
+            YAML::Node node(YAML::NodeType::Map);
+            for (auto &i : v)
+            {
+                node.force_insert(i.first, ToNode<T>()(i.second));
+            }
+            return node;
         }
+    };
 
-        std::string toString() override
+    template <class T>
+    class FromNode<std::unordered_map<std::string, T>>
+    {
+    public:
+        std::unordered_map<std::string, T> operator()(const YAML::Node &node)
         {
-            try
-            {
-                MutexType::Lock lock(mutex_);
-                return ToStr()(value_);
-            }
-            catch (std::exception &e)
+            std::unordered_map<std::string, T> result;
+            for (auto iter = node.begin(); iter != node.end(); iter++)
             {
-                BLUESKY_LOG_ERROR(BLUESKY_LOG_ROOT()) << "ConfigVar::to_string() exception"
-                                                      << e.what() << " convert: " << typeid(value_).name() << " to string";
+                result.insert(std::make_pair(iter->first.Scalar(), FromNode<T>()(iter->second)));
             }
-            return "";
+            return result;
         }
+    };
 
-        bool fromString(const std::string &val) override
+    template <class T>
+    class ToNode<std::unordered_map<std::string, T>>
+    {
+    public:
+        YAML::Node operator()(const std::unordered_map<std::string, T> &v)
         {
-            try
+            //键不会重复,force_insert不需要逐个比较已有的键
+            YAML::Node node(YAML::NodeType::Map);
+            for (auto &i : v)
             {
-                set_value(FromStr()(val));
+                node.force_insert(i.first, ToNode<T>()(i.second));
             }
-            catch (std::exception &e)
-            {
-                BLUESKY_LOG_ERROR(BLUESKY_LOG_ROOT()) << "ConfigVar::from_string() exception "
-                                                      << e.what() << " convert string to: " << typeid(value_).name();
-            }
-            return true;
+            return node;
         }
+    };
 
-        const T get_value()
-        { 
-            MutexType::Lock lock(mutex_);
-            return value_;
-        }
-        void set_value(const T &value) {
-            MutexType::Lock lock(mutex_);
-            if(value==value_){
-                return;
-            }
-            for(auto& call:callbacks_){
-                call.second(value_, value);
-            }
-            value_ = value;
-        }
-        std::string get_typename() const override { return typeid(T).name(); }
-        uint64_t add_listener(const on_change_cb& callback)
+
+    //容器与字符串之间的转换经过YAML::Node,整个值只解析/输出一次
+    template <class T>
+    class LexicalCast<std::string, std::vector<T>>
+    {
+    public:
+        std::vector<T> operator()(const std::string &v)
         {
-            static uint64_t key_id=0;
-            MutexType::Lock lock(mutex_);
-            ++key_id;
-            callbacks_[key_id] = callback;
-            return key_id;
+            return FromNode<std::vector<T>>()(YAML::Load(v));
         }
-        void delete_listener(uint64_t key)
+    };
+
+    template <class T>
+    class LexicalCast<std::vector<T>, std::string>
+    {
+    public:
+        std::string operator()(const std::vector<T> &v)
         {
-            MutexType::Lock lock(mutex_);
-            callbacks_.erase(key);
+            std::stringstream ss;
+            ss << ToNode<std::vector<T>>()(v);
+            return ss.str();
         }
-        on_change_cb get_listener(uint64_t key)
+    };
+
+    template <class T>
+    class LexicalCast<std::string, std::list<T>>
+    {
+    public:
+        std::list<T> operator()(const std::string &v)
         {
-            MutexType::Lock lock(mutex_);
-            auto iter = callbacks_.find(key);
-            return iter == callbacks_.end() ? nullptr : iter->second;
+            return FromNode<std::list<T>>()(YAML::Load(v));
         }
+    };
 
-        void clearListener()
+    template <class T>
+    class LexicalCast<std::list<T>, std::string>
+    {
+    public:
+        std::string operator()(const std::list<T> &v)
         {
-            MutexType::Lock lock(mutex_);
-            callbacks_.clear();
+            std::stringstream ss;
+            ss << ToNode<std::list<T>>()(v);
+            return ss.str();
         }
-
-    private:
-        T value_;
-        //变更通知回调数组
-        std::map<uint64_t, on_change_cb> callbacks_;
-        MutexType mutex_;
     };
 
-    /*配置集合类。 提供所有配置项的ConfigVar的统一管理功能。
- *加载配置文件，更新配置文件，定义配置项等等
- *重要的函数：
- *  Lookup, 3个参数签名： 创建和定义配置项,同一个配置项只能创建一次否则会冲突
- *   Lookup, 1个参数签名： 获取对应名称的配置项,用来获取上面函数创建的配置项
- *   LoadFromConfDir: 加载配置文件,加载一个目录下面的所有yaml文件
- *                   支持多文件,不同的配置项可以分开文件定义
- *  Visit： 便利所有配置项的方法。可以用来可视化输出
- */
-
-    class Config
+    template <class T>
+    class LexicalCast<std::string, std::set<T>>
     {
     public:
-        typedef std::map<std::string, std::shared_ptr<ConfigVarBase>> ConfigVarMap;
-        typedef Mutex MutexType;
+        std::set<T> operator()(const std::string &v)
+        {
+            return FromNode<std::set<T>>()(YAML::Load(v));
+        }
+    };
 
-        template <class T>
-        /*将指定名称的配置项加入进来*/
-        static typename std::shared_ptr<ConfigVar<T>> lookup(const std::string &name,
-                                                             const T &value,
-                                                             const std::string &description = "")
+    template <class T>
+    class LexicalCast<std::set<T>, std::string>
+    {
+    public:
+        std::string operator()(const std::set<T> &v)
         {
-            MutexType::Lock lock(get_mutex()); 
-            auto iter=get_configs().find(name);
-            if(iter!=get_configs().end())
-            {
-            auto temp = std::dynamic_pointer_cast<ConfigVar<T>>(iter->second);
-            if (temp)
+            std::stringstream ss;
+            ss << ToNode<std::set<T>>()(v);
+            return ss.str();
+        }
+    };
+
+    template <class T>
+    class LexicalCast<std::string, std::unordered_set<T>>
+    {
+    public:
+        std::unordered_set<T> operator()(const std::string &v)
+        {
+            return FromNode<std::unordered_set<T>>()(YAML::Load(v));
+        }
+    };
+
+    template <class T>
+    class LexicalCast<std::unordered_set<T>, std::string>
+    {
+    public:
+        std::string operator()(const std::unordered_set<T> &v)
+        {
+            std::stringstream ss;
+            ss << ToNode<std::unordered_set<T>>()(v);
+            return ss.str();
+        }
+    };
+
+    template <class T>
+    class LexicalCast<std::string, std::map<std::string, T>>
+    {
+    public:
+        std::map<std::string, T> operator()(const std::string &v)
+        {
+            return FromNode<std::map<std::string, T>>()(YAML::Load(v));
+        }
+    };
+
+    template <class T>
+    class LexicalCast<std::map<std::string, T>, std::string>
+    {
+    public:
+        std::string operator()(const std::map<std::string, T> &v)
+        {
+            std::stringstream ss;
+            ss << ToNode<std::map<std::string, T>>()(v);
+            return ss.str();
+        }
+    };
+
+    template <class T>
+    class LexicalCast<std::string, std::unordered_map<std::string, T>>
+    {
+    public:
+        std::unordered_map<std::string, T> operator()(const std::string &v)
+        {
+            return FromNode<std::unordered_map<std::string, T>>()(YAML::Load(v));
+        }
+    };
+
+    template <class T>
+    class LexicalCast<std::unordered_map<std::string, T>, std::string>
+    {
+    public:
+        std::string operator()(const std::unordered_map<std::string, T> &v)
+        {
+            std::stringstream ss;
+            ss << ToNode<std::unordered_map<std::string, T>>()(v);
+            return ss.str();
+        }
+    };
+
+    //PersistentMap逐个插入,与std::map的格式相同
+    template <class T>
+    class FromNode<PersistentMap<std::string, T>>
+    {
+    public:
+        PersistentMap<std::string, T> operator()(const YAML::Node &node)
+        {
+            PersistentMap<std::string, T> result;
+            for (auto iter = node.begin(); iter != node.end(); iter++)
+            {
+                result = result.set(iter->first.Scalar(), FromNode<T>()(iter->second));
+            }
+            return result;
+        }
+    };
+
+    template <class T>
+    class ToNode<PersistentMap<std::string, T>>
+    {
+    public:
+        YAML::Node operator()(const PersistentMap<std::string, T> &v)
+        {
+            YAML::Node node(YAML::NodeType::Map);
+            v.for_each([&node](const std::string &key, const T &value)
+                       { node.force_insert(key, ToNode<T>()(value)); });
+            return node;
+        }
+    };
+
+    template <class T>
+    class LexicalCast<std::string, PersistentMap<std::string, T>>
+    {
+    public:
+        PersistentMap<std::string, T> operator()(const std::string &v)
+        {
+            return FromNode<PersistentMap<std::string, T>>()(YAML::Load(v));
+        }
+    };
+
+    template <class T>
+    class LexicalCast<PersistentMap<std::string, T>, std::string>
+    {
+    public:
+        std::string operator()(const PersistentMap<std::string, T> &v)
+        {
+            std::stringstream ss;
+            ss << ToNode<PersistentMap<std::string, T>>()(v);
+            return ss.str();
+        }
+    };
+
+    /* 新值发布前与当前值合并,默认直接使用新值
+     * 支持结构共享的类型特化为以当前值为基础只应用差异:重新加载之后新旧版本共享没有变化的部分,
+     * 监听回调期间两个版本同时存在也只多占用变化部分的内存,比较新旧值时跳过共享的部分
+     */
+    template <class T>
+    class ConfigShare
+    {
+    public:
+        static const bool enabled = false;
+        std::shared_ptr<const T> operator()(const std::shared_ptr<const T> &current, const std::shared_ptr<const T> &value)
+        {
+            return value;
+        }
+    };
+
+    template <class K, class V, class Hash>
+    class ConfigShare<PersistentMap<K, V, Hash>>
+    {
+    public:
+        static const bool enabled = true;
+        std::shared_ptr<const PersistentMap<K, V, Hash>> operator()(const std::shared_ptr<const PersistentMap<K, V, Hash>> &current,
+                                                                    const std::shared_ptr<const PersistentMap<K, V, Hash>> &value)
+        {
+            return std::make_shared<const PersistentMap<K, V, Hash>>(PersistentMap<K, V, Hash>::rebase(*current, *value));
+        }
+    };
+
+    /* 比较新旧值,相同时不发布也不通知,默认使用operator==
+     * 没有operator==的类型(例如BLUESKY_CONFIG_STRUCT绑定的结构体)特化这个类,
+     * vector/list/set/map/unordered_map按元素的ConfigEqual比较
+     */
+    template <class T>
+    class ConfigEqual
+    {
+    public:
+        bool operator()(const T &lhs, const T &rhs)
+        {
+            return lhs == rhs;
+        }
+    };
+
+    //容器逐个元素使用ConfigEqual比较,元素是绑定的结构体时容器也不需要operator==
+    template <class Container>
+    class ConfigEqualSequence
+    {
+    public:
+        bool operator()(const Container &lhs, const Container &rhs)
+        {
+            return lhs.size() == rhs.size() &&
+                   std::equal(lhs.begin(), lhs.end(), rhs.begin(),
+                              [](const typename Container::value_type &l, const typename Container::value_type &r)
+                              { return ConfigEqual<typename Container::value_type>()(l, r); });
+        }
+    };
+
+    template <class T>
+    class ConfigEqual<std::vector<T>> : public ConfigEqualSequence<std::vector<T>>
+    {
+    };
+
+    template <class T>
+    class ConfigEqual<std::list<T>> : public ConfigEqualSequence<std::list<T>>
+    {
+    };
+
+    template <class T>
+    class ConfigEqual<std::set<T>> : public ConfigEqualSequence<std::set<T>>
+    {
+    };
+
+    template <class T>
+    class ConfigEqual<std::map<std::string, T>>
+    {
+    public:
+        bool operator()(const std::map<std::string, T> &lhs, const std::map<std::string, T> &rhs)
+        {
+            return lhs.size() == rhs.size() &&
+                   std::equal(lhs.begin(), lhs.end(), rhs.begin(),
+                              [](const std::pair<const std::string, T> &l, const std::pair<const std::string, T> &r)
+                              { return l.first == r.first && ConfigEqual<T>()(l.second, r.second); });
+        }
+    };
+
+    template <class T>
+    class ConfigEqual<std::unordered_map<std::string, T>>
+    {
+    public:
+        bool operator()(const std::unordered_map<std::string, T> &lhs, const std::unordered_map<std::string, T> &rhs)
+        {
+            if (lhs.size() != rhs.size())
+            {
+                return false;
+            }
+            for (auto &item : lhs)
+            {
+                auto iter = rhs.find(item.first);
+                if (iter == rhs.end() || !ConfigEqual<T>()(item.second, iter->second))
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+    };
+
+    /* 配置值的二进制表示,用于配置快照(ConfigSnapshot)
+     * 算术类型和std::string直接保存内存表示,加载时不需要解析;其他类型没有二进制表示
+     */
+    template <class T, class Enable = void>
+    class ConfigBinary
+    {
+    public:
+        static bool save(const T &v, std::string &out) { return false; }
+        static bool load(const char *data, size_t size, T &v) { return false; }
+    };
+
+    template <class T>
+    class ConfigBinary<T, typename std::enable_if<std::is_arithmetic<T>::value>::type>
+    {
+    public:
+        static bool save(const T &v, std::string &out)
+        {
+            out.assign((const char *)&v, sizeof(T));
+            return true;
+        }
+        static bool load(const char *data, size_t size, T &v)
+        {
+            if (size != sizeof(T))
+            {
+                return false;
+            }
+            memcpy(&v, data, sizeof(T));
+            return true;
+        }
+    };
+
+    template <>
+    class ConfigBinary<std::string>
+    {
+    public:
+        static bool save(const std::string &v, std::string &out)
+        {
+            out = v;
+            return true;
+        }
+        static bool load(const char *data, size_t size, std::string &v)
+        {
+            v.assign(data, size);
+            return true;
+        }
+    };
+
+    /* 配置项的约束:取值范围、枚举集合、自定义校验以及是否需要重启
+     * 在Config::lookup时声明,每次设置新值(加载文件、fromString、set_value)都会校验,
+     * 不满足约束的值不会被发布。
+     *  Config::lookup<uint32_t>("fiber.stack_size", 1024 * 1024,
+     *                           ConfigRule<uint32_t>().min(16 * 1024).max(64 * 1024 * 1024), "fiber stack size");
+     * min/max要求T支持operator<,one_of要求T支持operator==,只在使用时才需要
+     */
+    template <class T>
+    class ConfigRule
+    {
+    public:
+        //校验通过返回true,否则返回false并设置error
+        typedef std::function<bool(const T &value, std::string &error)> Validator;
+
+        ConfigRule &min(const T &bound)
+        {
+            checks_.push_back([bound](const T &value, std::string &error)
+                              {
+                                  if (value < bound)
+                                  {
+                                      error = "less than min " + LexicalCast<T, std::string>()(bound);
+                                      return false;
+                                  }
+                                  return true;
+                              });
+            return *this;
+        }
+
+        ConfigRule &max(const T &bound)
+        {
+            checks_.push_back([bound](const T &value, std::string &error)
+                              {
+                                  if (bound < value)
+                                  {
+                                      error = "greater than max " + LexicalCast<T, std::string>()(bound);
+                                      return false;
+                                  }
+                                  return true;
+                              });
+            return *this;
+        }
+
+        ConfigRule &one_of(const std::vector<T> &values)
+        {
+            checks_.push_back([values](const T &value, std::string &error)
+                              {
+                                  if (std::find(values.begin(), values.end(), value) != values.end())
+                                  {
+                                      return true;
+                                  }
+                                  error = "not one of [";
+                                  for (size_t i = 0; i < values.size(); i++)
+                                  {
+                                      error += (i ? ", " : "") + LexicalCast<T, std::string>()(values[i]);
+                                  }
+                                  error += "]";
+                                  return false;
+                              });
+            return *this;
+        }
+
+        ConfigRule &validator(const Validator &check)
+        {
+            checks_.push_back(check);
+            return *this;
+        }
+
+        ConfigRule &restart_required(bool value = true)
+        {
+            restartRequired_ = value;
+            return *this;
+        }
+
+        bool is_restart_required() const { return restartRequired_; }
+
+        bool check(const T &value, std::string &error) const
+        {
+            for (auto &check : checks_)
+            {
+                if (!check(value, error))
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+    private:
+        std::vector<Validator> checks_;
+        bool restartRequired_ = false;
+    };
+
+    template <class T, class FromStr, class ToStr>
+    class ConfigVar;
+
+    /* 配置事务:暂存多个配置项的新值,commit时一次性发布
+     * 全局代数(generation)是一个seqlock:发布期间为奇数,发布完成后为偶数。
+     * 单个set_value也是只有一个配置项的事务,所有发布由同一把锁串行执行。
+     * 读者在Config::consistent_read中读取多个配置项,看到的要么全是事务前的值,要么全是事务后的值;
+     * 变更回调在全部发布完成之后才执行,回调中读取其它配置项同样能看到完整的新状态。
+     * 没有commit的事务析构时直接丢弃
+     */
+    class ConfigTransaction
+    {
+    public:
+        //发布时加写锁,只读取历史等状态时加读锁
+        typedef RWMutex MutexType;
+
+        //source: 之后暂存的新值的来源,决定覆盖的优先级
+        ConfigTransaction(ConfigSource::Type source = ConfigSource::RUNTIME) : source_(source) {}
+        void set_source(ConfigSource::Type source) { source_ = source; }
+
+        /* 暂存新值,类型转换或者ConfigRule校验失败时返回false并记录错误。
+         * 有错误的事务在commit时整体拒绝,不会只发布其中一部分
+         */
+        template <class T, class FromStr, class ToStr>
+        bool set(const std::shared_ptr<ConfigVar<T, FromStr, ToStr>> &var, const T &value);
+        bool set_string(const ConfigVarBase::Ptr &var, const std::string &value);
+        bool set_node(const ConfigVarBase::Ptr &var, const YAML::Node &node);
+        //二进制表示见ConfigBinary
+        bool set_binary(const ConfigVarBase::Ptr &var, const char *data, size_t size);
+        //恢复为注册时的默认值,来源记为DEFAULT;已经有环境变量/命令行覆盖值的配置项不受影响
+        void reset(const ConfigVarBase::Ptr &var);
+
+        size_t size() const { return changes_.size(); }
+        void clear()
+        {
+            changes_.clear();
+            errors_.clear();
+        }
+
+        bool has_error() const { return !errors_.empty(); }
+        //每个错误一条,格式为"配置名称: 原因"
+        const std::vector<std::string> &get_errors() const { return errors_; }
+
+        //发布暂存的所有新值并通知监听者,返回值发生变化的配置项个数;有错误时不发布任何值,返回0
+        size_t commit();
+
+        /* 把配置回滚到代数generation时的状态(见ConfigHistory),作为一次新的发布,
+         * 只有值与当前不同的配置项会被修改和通知;generation已经不在历史中时返回false
+         */
+        static bool rollback(uint64_t generation);
+
+        //当前代数,奇数表示正在发布
+        static uint64_t get_generation() { return get_counter().load(std::memory_order_acquire); }
+
+        //发布一组新值,调用方需要持有get_mutex()
+        static void begin_publish() { get_counter().fetch_add(1, std::memory_order_acq_rel); }
+        static void end_publish() { get_counter().fetch_add(1, std::memory_order_release); }
+        static MutexType &get_mutex()
+        {
+            static MutexType mutex_;
+            return mutex_;
+        }
+
+    private:
+        static std::atomic<uint64_t> &get_counter()
+        {
+            static std::atomic<uint64_t> generation_{0};
+            return generation_;
+        }
+
+    private:
+        struct Change
+        {
+            ConfigVarBase::Ptr var;
+            ConfigVarBase::Pending::Ptr pending;
+            ConfigSource::Type source;
+        };
+
+        void add(const ConfigVarBase::Ptr &var, const ConfigVarBase::Pending::Ptr &pending, const std::string &error);
+        //在发布锁内发布changes并记录历史,返回值发生变化的下标;调用方在锁外通知
+        static std::vector<size_t> publish(const std::vector<Change> &changes);
+        //锁外通知发生变化的配置项
+        static void notify(const std::vector<Change> &changes, const std::vector<size_t> &changed);
+
+    private:
+        std::vector<Change> changes_;
+        std::vector<std::string> errors_;
+        ConfigSource::Type source_;
+    };
+
+    /* 配置历史:保存最近若干次发布之后的全部配置值,按发布完成后的全局代数寻址,用于快速回滚
+     * 每个版本是配置项编号到值快照的不可变映射(PersistentMap),相邻版本共享未变化的节点,
+     * 值快照本身也是发布时的shared_ptr,不会复制;每次发布只增加与变化的配置项个数相关的内存。
+     * 版本中只出现发布过新值的配置项,其余配置项的值是它们第一次被修改之前的值,单独记录在基线中。
+     * 所有修改在发布锁(ConfigTransaction::get_mutex)内进行
+     */
+    class ConfigHistory
+    {
+    public:
+        typedef PersistentMap<uint32_t, std::shared_ptr<const void>> Values;
+
+        //保留的版本数,至少为1,默认16
+        static void set_capacity(size_t capacity);
+        static size_t get_capacity();
+        //保留的版本对应的代数,从旧到新;启动时的初始状态是代数0
+        static std::vector<uint64_t> get_generations();
+
+        //在发布锁内调用:记录一个值发生变化的配置项
+        static void add(uint32_t id, const ConfigVarBase::Pending::Ptr &pending);
+        //在发布锁内调用:发布完成后保存一个版本,本次发布没有变化时不保存
+        static void push(uint64_t generation);
+        /* 在发布锁内调用:计算回滚到generation需要修改的配置项,callback(id, value)
+         * generation早于保留的最旧版本或者晚于当前代数时返回false
+         */
+        static bool diff(uint64_t generation, const std::function<void(uint32_t, const std::shared_ptr<const void> &)> &callback);
+    };
+
+    /* T: 参数类型
+     * FromStr: 将string转换为T类型
+     * ToStr: 将T类型转换为string
+     */
+    template <class T,
+              class FromStr = LexicalCast<std::string, T>,
+              class ToStr = LexicalCast<T, std::string>>
+    class ConfigVar : public ConfigVarBase
+    {
+    public:
+        typedef std::shared_ptr<ConfigVar> Ptr;
+        typedef std::function<void(const T &old_value, const T &new_value)> on_change_cb;
+        typedef Mutex MutexType;   
+    
+        ConfigVar(const std::string &name, const T &value, const std::string &description = "")
+            : ConfigVarBase(name, description), value_(std::make_shared<const T>(value)), default_(value_)
+        {
+        }
+
+        std::string toString() override
+        {
+            std::shared_ptr<const T> value = get_snapshot();
+            try
+            {
+                return ToStr()(*value);
+            }
+            catch (std::exception &e)
+            {
+                BLUESKY_LOG_ERROR(BLUESKY_LOG_ROOT()) << "ConfigVar::to_string() exception"
+                                                      << e.what() << " convert: " << typeid(T).name() << " to string";
+            }
+            return "";
+        }
+
+        bool fromString(const std::string &val) override
+        {
+            std::string error;
+            Pending::Ptr pending = stage_string(val, error);
+            if (!pending)
+            {
+                BLUESKY_LOG_ERROR(BLUESKY_LOG_ROOT()) << "ConfigVar::from_string() name=" << get_configname()
+                                                      << " value=" << val << " " << error;
+                return false;
+            }
+            publish(pending);
+            return true;
+        }
+
+        //使用默认的ToStr时直接转换成节点,自定义了ToStr则仍然经过字符串
+        YAML::Node toNode() override
+        {
+            return to_node(std::is_same<ToStr, LexicalCast<T, std::string>>());
+        }
+
+        bool toBinary(std::string &out) override
+        {
+            return ConfigBinary<T>::save(*get_snapshot(), out);
+        }
+
+        bool fromBinary(const char *data, size_t size) override
+        {
+            T value;
+            return ConfigBinary<T>::load(data, size, value) && set_value(value);
+        }
+
+        Pending::Ptr stage_binary(const char *data, size_t size, std::string &error) override
+        {
+            T value;
+            if (!ConfigBinary<T>::load(data, size, value))
+            {
+                error = std::string("load binary ") + typeid(T).name() + " failed";
+                return nullptr;
+            }
+            return stage(value, error);
+        }
+
+        bool fromNode(const YAML::Node &node) override
+        {
+            std::string error;
+            Pending::Ptr pending = stage_node(node, error);
+            if (!pending)
+            {
+                BLUESKY_LOG_ERROR(BLUESKY_LOG_ROOT()) << "ConfigVar::from_node() name=" << get_configname()
+                                                      << " " << error;
+                return false;
+            }
+            publish(pending);
+            return true;
+        }
+
+        //返回当前值的拷贝
+        const T get_value() const
+        {
+            return *get_snapshot();
+        }
+
+        /* 返回当前值的只读快照,读取时不加锁也不拷贝T
+         * 快照在持有期间保持不变,set_value发布的新值不会影响已经取出的快照
+         */
+        std::shared_ptr<const T> get_snapshot() const
+        {
+            return std::atomic_load(&value_);
+        }
+
+        //每次发布新值时递增,调用方可以缓存快照,版本号不变时无需重新读取
+        uint64_t get_version() const { return version_.load(std::memory_order_acquire); }
+
+        /* 读缓存:保存一份快照及其版本号,版本号没有变化时直接返回缓存的快照,
+         * 稳定状态下每次读取只有一次原子读,不加锁也不分配内存。
+         * 非线程安全,适合作为线程局部变量或者对象成员在热点路径上使用
+         */
+        class Reader
+        {
+        public:
+            Reader(const std::shared_ptr<ConfigVar> &var) : var_(var) {}
+
+            const T &get()
+            {
+                uint64_t version = var_->get_version();
+                if (!value_ || version != version_)
+                {
+                    value_ = var_->get_snapshot();
+                    version_ = version;
+                }
+                return *value_;
+            }
+
+        private:
+            std::shared_ptr<ConfigVar> var_;
+            std::shared_ptr<const T> value_;
+            uint64_t version_ = 0;
+        };
+
+        /* 发布新值并通知监听者
+         * 回调在锁外执行,回调中可以读取甚至修改本配置项;同步模式下回调在新值发布之后按发布顺序执行,
+         * 一般由调用线程执行,其他线程正在执行本配置项的回调时交给那个线程(见drain_notifications);
+         * 异步模式下交给配置通知线程
+         */
+        bool set_value(const T &value)
+        {
+            std::string error;
+            Pending::Ptr pending = stage(value, error);
+            if (!pending)
+            {
+                BLUESKY_LOG_ERROR(BLUESKY_LOG_ROOT()) << "ConfigVar::set_value() name=" << get_configname()
+                                                      << " " << error;
+                return false;
+            }
+            publish(pending);
+            return true;
+        }
+
+        //设置约束,当前值不满足约束时只输出错误,不修改当前值
+        void set_rule(const ConfigRule<T> &rule)
+        {
+            std::shared_ptr<const ConfigRule<T>> value(new ConfigRule<T>(rule));
+            std::atomic_store(&rule_, value);
+            restartRequired_ = rule.is_restart_required();
+            std::string error;
+            if (!rule.check(*get_snapshot(), error))
+            {
+                BLUESKY_LOG_ERROR(BLUESKY_LOG_ROOT()) << "ConfigVar::set_rule() name=" << get_configname()
+                                                      << " current value " << error;
+            }
+        }
+
+        Pending::Ptr stage_string(const std::string &val, std::string &error) override
+        {
+            try
+            {
+                return stage(FromStr()(val), error);
+            }
+            catch (std::exception &e)
             {
-                BLUESKY_LOG_INFO(BLUESKY_LOG_ROOT()) << "look up name: " << name << " exists";
-                return temp;
+                error = std::string("convert string to ") + typeid(T).name() + " failed: " + e.what();
             }
-            else{
-                BLUESKY_LOG_ERROR(BLUESKY_LOG_ROOT()) << "look up name=" << name << " exists but type= " << typeid(T).name()
-                                                      << " not equal real type= " << iter->second->get_typename()
-                                                      << " " << iter->second->toString();
+            return nullptr;
+        }
+
+        //使用默认的FromStr时直接从节点转换,自定义了FromStr则仍然经过字符串
+        Pending::Ptr stage_node(const YAML::Node &node, std::string &error) override
+        {
+            return stage_node(node, error, std::is_same<FromStr, LexicalCast<std::string, T>>());
+        }
+
+        bool apply_pending(const Pending::Ptr &pending) override
+        {
+            PendingValue *change = static_cast<PendingValue *>(pending.get());
+            MutexType::Lock lock(mutex_);
+            change->old_value = std::atomic_load(&value_);
+            if (change->new_value == change->old_value || ConfigEqual<T>()(*change->new_value, *change->old_value))
+            {
+                return false;
+            }
+            //写者之间由发布锁互斥,读者通过原子操作取得新的快照
+            std::atomic_store(&value_, change->new_value);
+            version_.fetch_add(1, std::memory_order_release);
+            if (is_async_notify())
+            {
+                //已经有待通知的变更时只更新最新值,旧值保持不变
+                change->post = !pendingOld_;
+                if (change->post)
+                {
+                    pendingOld_ = change->old_value;
+                }
+                pendingNew_ = change->new_value;
+            }
+            else if (!callbacks_->empty())
+            {
+                //在发布锁内入队,队列中的顺序就是发布的顺序
+                Notification notification = {change->old_value, change->new_value, callbacks_};
+                notifications_.push_back(notification);
+                change->queued = true;
+            }
+            return true;
+        }
+
+        void notify_changed(const Pending::Ptr &pending) override
+        {
+            PendingValue *change = static_cast<PendingValue *>(pending.get());
+            if (is_restart_required())
+            {
+                BLUESKY_LOG_WARN(BLUESKY_LOG_ROOT()) << "config " << get_configname()
+                                                     << " changed, restart required to take full effect";
+            }
+            if (change->post)
+            {
+                ConfigNotifier::get_instance().post(shared_from_this());
+            }
+            else if (change->queued)
+            {
+                drain_notifications();
+            }
+        }
+
+        void notify_pending() override
+        {
+            std::shared_ptr<const T> old_value;
+            std::shared_ptr<const T> new_value;
+            CallbackMap callbacks;
+            {
+                MutexType::Lock lock(mutex_);
+                old_value.swap(pendingOld_);
+                new_value.swap(pendingNew_);
+                callbacks = callbacks_;
+            }
+            //合并后值没有变化则不通知
+            if (old_value && new_value && !ConfigEqual<T>()(*old_value, *new_value))
+            {
+                dispatch(callbacks, *old_value, *new_value);
+            }
+        }
+
+        Pending::Ptr stage_erased(const std::shared_ptr<const void> &value) override
+        {
+            std::shared_ptr<PendingValue> pending(new PendingValue);
+            //同一个编号始终对应同一个配置项,历史中保存的一定是T的快照
+            pending->new_value = std::static_pointer_cast<const T>(value);
+            return pending;
+        }
+
+        std::shared_ptr<const void> get_default() const override { return default_; }
+
+        std::string get_typename() const override { return typeid(T).name(); }
+        uint64_t add_listener(const on_change_cb& callback)
+        {
+            static std::atomic<uint64_t> key_id{0};
+            uint64_t key = ++key_id;
+            MutexType::Lock lock(mutex_);
+            std::shared_ptr<std::map<uint64_t, on_change_cb>> callbacks(new std::map<uint64_t, on_change_cb>(*callbacks_));
+            (*callbacks)[key] = callback;
+            callbacks_ = callbacks;
+            return key;
+        }
+        void delete_listener(uint64_t key)
+        {
+            MutexType::Lock lock(mutex_);
+            std::shared_ptr<std::map<uint64_t, on_change_cb>> callbacks(new std::map<uint64_t, on_change_cb>(*callbacks_));
+            callbacks->erase(key);
+            callbacks_ = callbacks;
+        }
+        on_change_cb get_listener(uint64_t key)
+        {
+            MutexType::Lock lock(mutex_);
+            auto iter = callbacks_->find(key);
+            return iter == callbacks_->end() ? nullptr : iter->second;
+        }
+
+        void clearListener()
+        {
+            MutexType::Lock lock(mutex_);
+            callbacks_.reset(new std::map<uint64_t, on_change_cb>);
+        }
+
+    private:
+        friend class ConfigTransaction;
+        typedef std::shared_ptr<const std::map<uint64_t, on_change_cb>> CallbackMap;
+
+        /* 同步通知:按发布顺序逐个执行队列中的变更,同一时刻只有一个线程在执行本配置项的回调。
+         * 已经有线程在执行时直接返回,入队的变更由那个线程接着执行,所以多个线程并发修改时
+         * 回调不会交错或者乱序;回调中再修改本配置项,新的通知在当前回调返回之后执行。
+         * 不等待其他线程,回调中修改其他配置项也不会死锁
+         */
+        void drain_notifications()
+        {
+            {
+                MutexType::Lock lock(mutex_);
+                if (dispatching_)
+                {
+                    return;
+                }
+                dispatching_ = true;
+            }
+            while (true)
+            {
+                Notification notification;
+                {
+                    MutexType::Lock lock(mutex_);
+                    if (notifications_.empty())
+                    {
+                        dispatching_ = false;
+                        return;
+                    }
+                    notification = notifications_.front();
+                    notifications_.pop_front();
+                }
+                dispatch(notification.callbacks, *notification.old_value, *notification.new_value);
+            }
+        }
+
+        void dispatch(const CallbackMap &callbacks, const T &old_value, const T &new_value)
+        {
+            for (auto &call : *callbacks)
+            {
+                try
+                {
+                    call.second(old_value, new_value);
+                }
+                catch (std::exception &e)
+                {
+                    BLUESKY_LOG_ERROR(BLUESKY_LOG_ROOT()) << "ConfigVar listener exception name=" << get_configname()
+                                                          << " " << e.what();
+                }
+            }
+        }
+
+    private:
+        struct PendingValue : public Pending
+        {
+            std::shared_ptr<const T> old_value;
+            std::shared_ptr<const T> new_value;
+            bool queued = false;
+            bool post = false;
+
+            std::shared_ptr<const void> get_old() const override { return old_value; }
+            std::shared_ptr<const void> get_new() const override { return new_value; }
+        };
+
+        Pending::Ptr stage(const T &value, std::string &error)
+        {
+            std::shared_ptr<const ConfigRule<T>> rule = std::atomic_load(&rule_);
+            if (rule && !rule->check(value, error))
+            {
+                error = "value " + error;
+                return nullptr;
+            }
+            std::shared_ptr<PendingValue> pending(new PendingValue);
+            pending->new_value = std::make_shared<const T>(value);
+            if (ConfigShare<T>::enabled)
+            {
+                pending->new_value = ConfigShare<T>()(get_snapshot(), pending->new_value);
+            }
+            return pending;
+        }
+
+        Pending::Ptr stage_node(const YAML::Node &node, std::string &error, std::true_type)
+        {
+            try
+            {
+                return stage(FromNode<T>()(node), error);
+            }
+            catch (std::exception &e)
+            {
+                error = std::string("convert node to ") + typeid(T).name() + " failed: " + e.what();
+            }
+            return nullptr;
+        }
+
+        Pending::Ptr stage_node(const YAML::Node &node, std::string &error, std::false_type)
+        {
+            return ConfigVarBase::stage_node(node, error);
+        }
+
+        YAML::Node to_node(std::true_type)
+        {
+            std::shared_ptr<const T> value = get_snapshot();
+            try
+            {
+                return ToNode<T>()(*value);
+            }
+            catch (std::exception &e)
+            {
+                BLUESKY_LOG_ERROR(BLUESKY_LOG_ROOT()) << "ConfigVar::to_node() exception"
+                                                      << e.what() << " convert: " << typeid(T).name() << " to node";
+            }
+            return YAML::Node();
+        }
+
+        YAML::Node to_node(std::false_type)
+        {
+            return ConfigVarBase::toNode();
+        }
+
+        //单个配置项的事务
+        void publish(const Pending::Ptr &pending)
+        {
+            bool changed = false;
+            {
+                ConfigTransaction::MutexType::WriteLock lock(ConfigTransaction::get_mutex());
+                ConfigTransaction::begin_publish();
+                update_source(ConfigSource::RUNTIME);
+                changed = apply_pending(pending);
+                ConfigTransaction::end_publish();
+                if (changed)
+                {
+                    ConfigHistory::add(get_id(), pending);
+                    ConfigHistory::push(ConfigTransaction::get_generation());
+                }
+            }
+            if (changed)
+            {
+                notify_changed(pending);
+            }
+        }
+
+    private:
+        std::shared_ptr<const T> value_;
+        const std::shared_ptr<const T> default_;
+        std::shared_ptr<const ConfigRule<T>> rule_;
+        std::atomic<uint64_t> version_{0};
+        //变更通知回调数组,修改时整体替换,通知时取快照后在锁外执行
+        CallbackMap callbacks_ = std::make_shared<const std::map<uint64_t, on_change_cb>>();
+        //异步通知模式下尚未通知的变更
+        std::shared_ptr<const T> pendingOld_;
+        std::shared_ptr<const T> pendingNew_;
+        //同步通知模式下等待执行的变更,按发布顺序排列
+        struct Notification
+        {
+            std::shared_ptr<const T> old_value;
+            std::shared_ptr<const T> new_value;
+            CallbackMap callbacks;
+        };
+        std::deque<Notification> notifications_;
+        bool dispatching_ = false;
+        MutexType mutex_;
+    };
+
+    /* 静态定义的配置项(ConfigStatic)等待注册的链表
+     * 命名空间作用域的ConfigStatic在静态初始化阶段构造,只把自己挂到这个无锁链表上,不加锁、不输出日志,
+     * 也不依赖其他编译单元中静态对象的初始化顺序(链表头是常量初始化的原子指针)。
+     * 第一次通过名称或者编号访问注册表时(Config::lookup_base等)一次性把链表中的配置项加入注册表
+     */
+    class ConfigStaticList
+    {
+    public:
+        struct Entry
+        {
+            Entry *next = nullptr;
+            ConfigVarBase::Ptr var;
+        };
+
+        //静态初始化阶段调用,entry需要一直有效直到被注册
+        static void push(Entry *entry);
+        //注册链表中所有的配置项,链表为空时只有一次原子读
+        static void register_all();
+
+    private:
+        static std::atomic<Entry *> head_;
+    };
+
+    /* 热点路径上的配置读缓存:每个线程保存一份值的拷贝以及读取时的全局代数
+     * 任何set_value或者事务提交都会递增全局代数,读取时只比较一次代数,相同时直接返回线程局部的拷贝,
+     * 稳定状态下只有一次原子读,不访问配置项本身的共享数据。
+     * 对象本身可以在多个线程间共享,线程局部的缓存按配置项编号存放
+     *  static ConfigCached<uint32_t> s_stack_size(g_fiber_stack_size);
+     *  uint32_t size = s_stack_size.get();
+     */
+    template <class T>
+    class ConfigCached
+    {
+    public:
+        ConfigCached(const typename ConfigVar<T>::Ptr &var) : var_(var) {}
+
+        const T &get() const
+        {
+            Slot &slot = get_slot();
+            uint64_t generation = ConfigTransaction::get_generation();
+            if (slot.generation != generation)
+            {
+                slot.value = *var_->get_snapshot();
+                slot.generation = generation;
+            }
+            return slot.value;
+        }
+
+        const typename ConfigVar<T>::Ptr &get_var() const { return var_; }
+
+    private:
+        struct Slot
+        {
+            Slot(const T &v) : value(v) {}
+            //全局代数从0开始,初始值保证第一次读取时刷新
+            uint64_t generation = (uint64_t)-1;
+            T value;
+        };
+
+        Slot &get_slot() const
+        {
+            static thread_local std::vector<std::unique_ptr<Slot>> t_slots;
+            uint32_t id = var_->get_id();
+            if (id == (uint32_t)-1)
+            {
+                //静态定义的配置项在第一次使用时才注册
+                ConfigStaticList::register_all();
+                id = var_->get_id();
+                if (id == (uint32_t)-1)
+                {
+                    throw std::logic_error("ConfigCached requires a registered config: " + var_->get_configname());
+                }
+            }
+            if (id >= t_slots.size())
+            {
+                t_slots.resize(id + 1);
+            }
+            if (!t_slots[id])
+            {
+                t_slots[id].reset(new Slot(*var_->get_snapshot()));
             }
+            return *t_slots[id];
+        }
+
+    private:
+        typename ConfigVar<T>::Ptr var_;
+    };
+
+    template <class T, class FromStr, class ToStr>
+    bool ConfigTransaction::set(const std::shared_ptr<ConfigVar<T, FromStr, ToStr>> &var, const T &value)
+    {
+        std::string error;
+        ConfigVarBase::Pending::Ptr pending = var->stage(value, error);
+        add(var, pending, error);
+        return pending != nullptr;
+    }
+
+    /* 配置名称的前缀树,按'.'分段,每个节点保存对应配置项的编号
+     * 不可变结构:插入时只复制从根到插入位置路径上的节点,其余节点与旧版本共享,
+     * 新版本构造完成后由ConfigRegistry原子替换根节点,遍历时不需要加锁
+     */
+    class ConfigTrie
+    {
+    public:
+        typedef std::shared_ptr<const ConfigTrie> Ptr;
+        static const uint32_t npos = (uint32_t)-1;
+
+        //返回插入之后的新版本,root可以为空
+        static Ptr insert(const Ptr &root, const std::string &name, uint32_t id);
+        //prefix对应的子树,空字符串对应整棵树,不存在返回nullptr
+        static Ptr find(const Ptr &root, const std::string &prefix);
+
+        uint32_t get_id() const { return id_; }
+        const std::map<std::string, Ptr> &get_children() const { return children_; }
+        //按名称顺序遍历子树中所有配置项的编号
+        void visit(const std::function<void(uint32_t)> &callback) const;
+
+    private:
+        static Ptr insert(const ConfigTrie *node, const std::vector<std::string> &segments, size_t idx, uint32_t id);
+
+    private:
+        std::map<std::string, Ptr> children_;
+        uint32_t id_ = npos;
+    };
+
+    /* 配置项注册表:配置名称映射为连续的整数编号
+     * 配置项按编号保存在分段数组中(第k段容量为2^k),扩容时已有元素不移动;
+     * 名称到编号使用开放寻址哈希表,槽位为64位原子量(高32位名称哈希,低32位编号+1)。
+     * 读操作(find/get/size)不加锁,写操作(add)由调用方持有Config的锁串行执行,
+     * 哈希表扩容时新表构造完成后原子替换,旧表保留到进程退出,正在读旧表的线程不受影响
+     */
+    class ConfigRegistry
+    {
+    public:
+        static const uint32_t npos = (uint32_t)-1;
+
+        ConfigRegistry();
+
+        //按名称查找编号,不存在返回npos
+        uint32_t find(const std::string &name) const;
+        ConfigVarBase::Ptr get(uint32_t id) const;
+        //已分配的编号个数
+        uint32_t size() const { return size_.load(std::memory_order_acquire); }
+        //注册配置项并分配编号,同名配置项已存在时名称改为指向新的配置项
+        uint32_t add(ConfigVarBase::Ptr var);
+        //名称前缀树的当前版本
+        ConfigTrie::Ptr get_trie() const { return std::atomic_load(&trie_); }
+
+    private:
+        struct Table
+        {
+            size_t mask;
+            std::atomic<uint64_t> *slots;
+        };
+
+        static uint32_t hash(const std::string &name);
+        static void insert(Table *table, uint64_t value);
+        ConfigVarBase::Ptr *slot(uint32_t id) const;
+
+    private:
+        std::atomic<Table *> table_;
+        std::vector<Table *> retired_;
+        std::atomic<ConfigVarBase::Ptr *> segments_[32];
+        std::atomic<uint32_t> size_{0};
+        uint32_t used_ = 0; //哈希表中已使用的槽位数
+        ConfigTrie::Ptr trie_;
+    };
+
+    /*配置集合类。 提供所有配置项的ConfigVar的统一管理功能。
+ *加载配置文件，更新配置文件，定义配置项等等
+ *重要的函数：
+ *  Lookup, 3个参数签名： 创建和定义配置项,同一个配置项只能创建一次否则会冲突
+ *   Lookup, 1个参数签名： 获取对应名称的配置项,用来获取上面函数创建的配置项
+ *   LoadFromConfDir: 加载配置文件,加载一个目录下面的所有yaml文件
+ *                   支持多文件,不同的配置项可以分开文件定义
+ *  Visit： 便利所有配置项的方法。可以用来可视化输出
+ */
+
+    class Config
+    {
+    public:
+        typedef std::map<std::string, std::shared_ptr<ConfigVarBase>> ConfigVarMap;
+        typedef Mutex MutexType;
+
+        template <class T>
+        /*将指定名称的配置项加入进来*/
+        static typename std::shared_ptr<ConfigVar<T>> lookup(const std::string &name,
+                                                             const T &value,
+                                                             const std::string &description = "")
+        {
+            //已经存在时不加锁直接返回
+            auto exist = std::dynamic_pointer_cast<ConfigVar<T>>(lookup_base(name));
+            if (exist)
+            {
+                BLUESKY_LOG_INFO(BLUESKY_LOG_ROOT()) << "look up name: " << name << " exists";
+                return exist;
             }
 
             if (name.find_first_not_of("abcdefghijklmnopqrstuvwxyz._0123456789") != std::string::npos)
@@ -404,29 +1663,128 @@ namespace bluesky
                 throw std::invalid_argument(name);
             }
 
-            typename std::shared_ptr<ConfigVar<T>> v(new ConfigVar<T>(name, value, description));
-            get_configs()[name] = v;
+            //锁内只查找和注册,日志在锁外输出:第一次输出日志会初始化LoggerManager,不应该持有配置锁
+            typename std::shared_ptr<ConfigVar<T>> v;
+            ConfigVarBase::Ptr conflict;
+            {
+                MutexType::Lock lock(get_mutex());
+                ConfigVarBase::Ptr base = get_registry().get(get_registry().find(name));
+                v = std::dynamic_pointer_cast<ConfigVar<T>>(base);
+                if (!v)
+                {
+                    conflict = base;
+                    v.reset(new ConfigVar<T>(name, value, description));
+                    get_registry().add(v);
+                }
+            }
+            if (conflict)
+            {
+                BLUESKY_LOG_ERROR(BLUESKY_LOG_ROOT()) << "look up name=" << name << " exists but type= " << typeid(T).name()
+                                                      << " not equal real type= " << conflict->get_typename()
+                                                      << " " << conflict->toString();
+            }
+            return v;
+        }
+        //定义配置项并设置约束,默认值也需要满足约束
+        template <class T>
+        static typename std::shared_ptr<ConfigVar<T>> lookup(const std::string &name,
+                                                             const T &value,
+                                                             const ConfigRule<T> &rule,
+                                                             const std::string &description = "")
+        {
+            typename std::shared_ptr<ConfigVar<T>> v = lookup(name, value, description);
+            v->set_rule(rule);
             return v;
         }
         template <class T>
         static typename std::shared_ptr<ConfigVar<T>> lookup(const std::string &name)
         {
-            MutexType::Lock lock(get_mutex());
-            auto iter = get_configs().find(name);
-            if (iter == get_configs().end())
-                return nullptr;
-            return std::dynamic_pointer_cast<ConfigVar<T>>(iter->second);
+            return std::dynamic_pointer_cast<ConfigVar<T>>(lookup_base(name));
+        }
+        //通过编号取得配置项,不需要查找名称
+        template <class T>
+        static typename std::shared_ptr<ConfigVar<T>> lookup(uint32_t id)
+        {
+            return std::dynamic_pointer_cast<ConfigVar<T>>(lookup_base(id));
         }
 
-        static void load_from_yaml(const YAML::Node &root);
+        /* 加载YAML,所有配置项作为一个事务发布
+         * 任何一个配置项转换或者校验失败时输出全部错误并拒绝整个更新,返回false
+         */
+        static bool load_from_yaml(const YAML::Node &root);
+
+        /* 加载目录下(含子目录)所有的.yml/.yaml配置文件
+         * 文件按路径排序,同一个配置项出现在多个文件中时以路径靠后的文件为准;
+         * 记录每个文件的修改时间和内容哈希,未变化的文件不会重新读取和解析,
+         * 只有变化文件中出现、并且内容与上一次加载时不同的配置项会被重新设置;
+         * 从所有文件中删除(包括文件本身被删除)的配置项恢复为默认值。
+         * force为true时忽略缓存全部重新加载
+         * 返回本次重新加载的文件数;有配置项校验失败时整个更新被拒绝,返回0,下次加载时重新读取这些文件
+         */
+        static size_t load_from_dir(const std::string &path, bool force = false);
+
+        /* 最近一次load_from_dir从path中读到的文件层的值,同一个配置项以路径靠后的文件为准
+         * 非标量的值为YAML文本,与set_node的转换方式一致;不包含环境变量、命令行和运行时的修改
+         */
+        static void get_file_values(const std::string &path, std::map<std::string, std::string> &values);
+
+        /* 加载环境变量和命令行中的覆盖值,在一个事务中发布
+         * 环境变量: prefix加上配置名称的大写形式,'.'替换为'_',例如BLUESKY_FIBER_STACK_SIZE对应fiber.stack_size
+         * 命令行: --name=value,名称不是已定义配置项的参数忽略
+         * 同一个配置项同时出现在两处时以命令行为准;覆盖值生效之后,配置文件中的同名配置项不再生效,
+         * 所以启动时先调用这个函数再加载配置文件,每个配置项只会被设置一次。
+         * 有配置项转换或者校验失败时拒绝全部覆盖值,返回false
+         */
+        static bool load_overlays(int argc, char **argv, const std::string &prefix = "BLUESKY_");
+
         static std::shared_ptr<ConfigVarBase> lookup_base(const std::string &name);
+        static std::shared_ptr<ConfigVarBase> lookup_base(uint32_t id);
+        //配置名称对应的编号,不存在时返回ConfigRegistry::npos
+        static uint32_t get_id(const std::string &name);
     
         static void visit_configs(std::function<void(ConfigVarBase::Ptr)>& callback);
+
+        /* 按名称顺序遍历prefix下的配置项,按'.'分段匹配:"fiber"匹配fiber以及fiber.stack_size,不匹配fibers;
+         * 末尾的".*"可以省略,空字符串遍历全部。遍历的是调用时注册表的快照,不加锁
+         */
+        static void visit_prefix(const std::string &prefix, const std::function<void(ConfigVarBase::Ptr)> &callback);
+        //把prefix下的配置项按名称分段导出为嵌套的YAML/JSON
+        static std::string dump_yaml(const std::string &prefix = "");
+        static std::string dump_json(const std::string &prefix = "");
+
+        /* 回滚到代数generation时的配置,可以回滚的代数见ConfigHistory::get_generations()
+         * 所有配置项在一次发布中恢复,只有值发生变化的配置项通知监听者
+         */
+        static bool rollback(uint64_t generation) { return ConfigTransaction::rollback(generation); }
+
+        /* 一致性读取:callback中读取的多个配置项来自同一个代数,不会读到事务发布了一半的状态。
+         * 读取期间有事务发布时callback会被重新执行,所以callback只应该读取配置、不应该有副作用
+         */
+        template <class F>
+        static void consistent_read(F callback)
+        {
+            while (true)
+            {
+                uint64_t generation = ConfigTransaction::get_generation();
+                if (generation & 1)
+                {
+                    sched_yield();
+                    continue;
+                }
+                callback();
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (ConfigTransaction::get_generation() == generation)
+                {
+                    return;
+                }
+            }
+        }
     
     private:
-        static ConfigVarMap& get_configs(){
-            static ConfigVarMap configs_;
-            return configs_;
+        friend class ConfigStaticList;
+        static ConfigRegistry& get_registry(){
+            static ConfigRegistry registry_;
+            return registry_;
         }
         static MutexType& get_mutex(){
             static MutexType mutex_;
@@ -434,6 +1792,41 @@ namespace bluesky
         }
     };
 
+    /* 静态定义配置项,用于命名空间作用域的全局配置:
+     *  static ConfigStatic<uint32_t> g_stack_size("fiber.stack_size", 1024 * 1024, "fiber stack size");
+     *  uint32_t size = g_stack_size->get_value();
+     * 构造时只创建配置项并挂到ConfigStaticList上,不访问注册表、不加锁、不输出日志,
+     * 可以安全地在静态初始化阶段使用;配置项在第一次访问注册表时统一注册,之后与Config::lookup定义的完全相同。
+     * 对象必须是静态存储期的,通过->或者get()直接访问配置项,不经过名称查找
+     */
+    template <class T>
+    class ConfigStatic
+    {
+    public:
+        typedef typename ConfigVar<T>::Ptr VarPtr;
+
+        ConfigStatic(const char *name, const T &value, const char *description = "")
+        {
+            var_.reset(new ConfigVar<T>(name, value, description));
+            entry_.var = var_;
+            ConfigStaticList::push(&entry_);
+        }
+        //默认值也需要满足约束
+        ConfigStatic(const char *name, const T &value, const ConfigRule<T> &rule, const char *description = "")
+            : ConfigStatic(name, value, description)
+        {
+            var_->set_rule(rule);
+        }
+
+        ConfigVar<T> *operator->() const { return var_.get(); }
+        const VarPtr &get() const { return var_; }
+        operator const VarPtr &() const { return var_; }
+
+    private:
+        VarPtr var_;
+        ConfigStaticList::Entry entry_;
+    };
+
 } //end of namespace
 
 #endif
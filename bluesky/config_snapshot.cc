@@ -0,0 +1,249 @@
+#include "config_snapshot.h"
+#include "util.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <limits.h>
+#include <unistd.h>
+
+namespace bluesky
+{
+    static const char s_magic[8] = {'B', 'L', 'S', 'K', 'C', 'O', 'N', 'F'};
+    static const uint32_t s_version = 2;
+
+    static_assert(sizeof(ConfigSnapshotHeader) == 48, "ConfigSnapshotHeader must be 32 bytes on disk");
+    static_assert(sizeof(ConfigSnapshotEntry) == 32, "ConfigSnapshotEntry must be 32 bytes on disk");
+
+    static uint64_t hash_string(const std::string &str)
+    {
+        return hash_fnv1a(str.data(), str.size());
+    }
+
+    static std::vector<ConfigVarBase::Ptr> all_configs()
+    {
+        std::vector<ConfigVarBase::Ptr> vars;
+        std::function<void(ConfigVarBase::Ptr)> cb = [&vars](ConfigVarBase::Ptr var)
+        {
+            vars.push_back(var);
+        };
+        Config::visit_configs(cb);
+        return vars;
+    }
+
+    //可执行文件的标识:重新编译或者换了程序之后快照失效,编译进程序的默认值和校验规则可能已经变化
+    static uint64_t binary_hash()
+    {
+        char path[PATH_MAX];
+        ssize_t n = readlink("/proc/self/exe", path, sizeof(path));
+        std::string id = n > 0 ? std::string(path, n) : std::string();
+        struct stat st;
+        if (stat("/proc/self/exe", &st) == 0)
+        {
+            uint64_t stamp[2] = {(uint64_t)st.st_mtim.tv_sec * 1000000000ULL + st.st_mtim.tv_nsec, (uint64_t)st.st_size};
+            id.append((const char *)stamp, sizeof(stamp));
+        }
+        return hash_string(id);
+    }
+
+    //已注册配置项的集合,与注册顺序无关
+    static uint64_t vars_hash(const std::vector<ConfigVarBase::Ptr> &vars)
+    {
+        std::vector<std::string> names;
+        for (auto &var : vars)
+        {
+            names.push_back(var->get_configname() + '\0' + var->get_typename());
+        }
+        std::sort(names.begin(), names.end());
+        std::string all;
+        for (auto &name : names)
+        {
+            all.append(name).push_back('\0');
+        }
+        return hash_string(all);
+    }
+
+    uint64_t ConfigSnapshot::source_hash(const std::string &dir)
+    {
+        std::vector<std::string> files;
+        list_all_files(files, dir, ".yml");
+        list_all_files(files, dir, ".yaml");
+        std::sort(files.begin(), files.end());
+        std::string hashes;
+        for (auto &file : files)
+        {
+            std::ifstream ifs(file);
+            std::stringstream ss;
+            ss << ifs.rdbuf();
+            std::string content = ss.str();
+            uint64_t hash[2] = {hash_string(file), hash_fnv1a(content.data(), content.size())};
+            hashes.append((const char *)hash, sizeof(hash));
+        }
+        return hash_string(hashes);
+    }
+
+    bool ConfigSnapshot::save(const std::string &file, const std::string &dir)
+    {
+        //只保存文件层的值:当前值来自文件时直接使用(可以保存二进制表示),
+        //被环境变量/命令行/运行时修改覆盖的配置项保存文件中的原始内容,文件中没有的配置项不保存
+        std::map<std::string, std::string> file_values;
+        Config::get_file_values(dir, file_values);
+        std::vector<ConfigVarBase::Ptr> vars = all_configs();
+        std::vector<ConfigSnapshotEntry> entries;
+        std::string data;
+        for (auto &var : vars)
+        {
+            auto iter = file_values.find(var->get_configname());
+            if (iter == file_values.end())
+            {
+                continue;
+            }
+            ConfigSnapshotEntry entry;
+            std::string value;
+            entry.binary = var->get_source() == ConfigSource::FILE && var->toBinary(value) ? 1 : 0;
+            if (!entry.binary)
+            {
+                value = iter->second;
+            }
+            entry.name_hash = hash_string(var->get_configname());
+            entry.type_hash = hash_string(var->get_typename());
+            entry.offset = data.size();
+            entry.size = value.size();
+            data.append(value);
+            entries.push_back(entry);
+        }
+        std::sort(entries.begin(), entries.end(), [](const ConfigSnapshotEntry &a, const ConfigSnapshotEntry &b)
+                  { return a.name_hash < b.name_hash; });
+
+        ConfigSnapshotHeader header;
+        memcpy(header.magic, s_magic, sizeof(s_magic));
+        header.version = s_version;
+        header.count = entries.size();
+        header.source_hash = source_hash(dir);
+        header.binary_hash = binary_hash();
+        header.vars_hash = vars_hash(vars);
+        header.data_offset = sizeof(header) + entries.size() * sizeof(ConfigSnapshotEntry);
+
+        //先写临时文件再rename,其他进程不会读到写了一半的快照
+        std::string tmp = file + ".tmp";
+        std::ofstream ofs(tmp, std::ios::binary | std::ios::trunc);
+        if (!ofs)
+        {
+            BLUESKY_LOG_ERROR(BLUESKY_LOG_ROOT()) << "ConfigSnapshot save open failed: " << tmp;
+            return false;
+        }
+        ofs.write((const char *)&header, sizeof(header));
+        ofs.write((const char *)entries.data(), entries.size() * sizeof(ConfigSnapshotEntry));
+        ofs.write(data.data(), data.size());
+        ofs.close();
+        if (!ofs || rename(tmp.c_str(), file.c_str()) != 0)
+        {
+            BLUESKY_LOG_ERROR(BLUESKY_LOG_ROOT()) << "ConfigSnapshot save failed: " << file;
+            unlink(tmp.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    bool ConfigSnapshot::load(const std::string &file, const std::string &dir)
+    {
+        int fd = open(file.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+        {
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(ConfigSnapshotHeader))
+        {
+            close(fd);
+            return false;
+        }
+        size_t size = st.st_size;
+        const char *base = (const char *)mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (base == MAP_FAILED)
+        {
+            return false;
+        }
+
+        const ConfigSnapshotHeader *header = (const ConfigSnapshotHeader *)base;
+        const ConfigSnapshotEntry *begin = (const ConfigSnapshotEntry *)(base + sizeof(ConfigSnapshotHeader));
+        const ConfigSnapshotEntry *end = begin + header->count;
+        std::vector<ConfigVarBase::Ptr> vars = all_configs();
+        bool valid = memcmp(header->magic, s_magic, sizeof(s_magic)) == 0 &&
+                     header->version == s_version &&
+                     header->data_offset == sizeof(ConfigSnapshotHeader) + header->count * sizeof(ConfigSnapshotEntry) &&
+                     header->data_offset <= size &&
+                     header->source_hash == source_hash(dir) &&
+                     header->binary_hash == binary_hash() &&
+                     header->vars_hash == vars_hash(vars);
+        if (!valid)
+        {
+            munmap((void *)base, size);
+            return false;
+        }
+
+        const char *data = base + header->data_offset;
+        size_t data_size = size - header->data_offset;
+        //与load_from_yaml一样作为一个FILE事务发布:只产生一个历史版本,不覆盖环境变量/命令行的覆盖值
+        ConfigTransaction transaction(ConfigSource::FILE);
+        for (auto &var : vars)
+        {
+            uint64_t name_hash = hash_string(var->get_configname());
+            const ConfigSnapshotEntry *entry = std::lower_bound(begin, end, name_hash,
+                                                                [](const ConfigSnapshotEntry &e, uint64_t hash)
+                                                                { return e.name_hash < hash; });
+            if (entry == end || entry->name_hash != name_hash ||
+                entry->type_hash != hash_string(var->get_typename()) ||
+                entry->offset + entry->size > data_size)
+            {
+                continue;
+            }
+            const char *value = data + entry->offset;
+            if (entry->binary)
+            {
+                transaction.set_binary(var, value, entry->size);
+            }
+            else
+            {
+                transaction.set_string(var, std::string(value, entry->size));
+            }
+        }
+        munmap((void *)base, size);
+        if (transaction.has_error())
+        {
+            //快照与当前的校验规则不一致,交给load_or_build从配置文件重建
+            std::stringstream ss;
+            ss << "ConfigSnapshot load " << file << " rejected, " << transaction.get_errors().size() << " invalid config:";
+            for (auto &error : transaction.get_errors())
+            {
+                ss << std::endl
+                   << "    " << error;
+            }
+            BLUESKY_LOG_ERROR(BLUESKY_LOG_ROOT()) << ss.str();
+            return false;
+        }
+        size_t applied = transaction.commit();
+        BLUESKY_LOG_INFO(BLUESKY_LOG_ROOT()) << "ConfigSnapshot load " << file << " applied=" << applied;
+        return true;
+    }
+
+    bool ConfigSnapshot::load_or_build(const std::string &file, const std::string &dir)
+    {
+        if (load(file, dir))
+        {
+            return true;
+        }
+        //强制重新加载,每个文件都成功加载之后文件层才是完整的;被拒绝的配置不能写进快照,否则以后每次启动都不再报错
+        std::vector<std::string> files;
+        list_all_files(files, dir, ".yml");
+        list_all_files(files, dir, ".yaml");
+        if (Config::load_from_dir(dir, true) != files.size())
+        {
+            BLUESKY_LOG_ERROR(BLUESKY_LOG_ROOT()) << "ConfigSnapshot load_from_dir " << dir << " failed, snapshot not saved";
+            return false;
+        }
+        return save(file, dir);
+    }
+
+} //end of namespace
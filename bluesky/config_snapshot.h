@@ -0,0 +1,56 @@
+#ifndef __BLUESKY_CONFIG_SNAPSHOT_H__
+#define __BLUESKY_CONFIG_SNAPSHOT_H__
+
+#include "config.h"
+
+namespace bluesky
+{
+    /* 配置快照:把已注册配置项在配置文件中的值保存成紧凑的二进制文件,下次启动时mmap读取,不再解析yaml
+     * 文件布局:
+     *      ConfigSnapshotHeader
+     *      ConfigSnapshotEntry[count]  按名称哈希排序,二分查找
+     *      数据区                       算术类型/std::string为内存表示,其他类型为字符串
+     * 只保存文件层的值:默认值、环境变量/命令行覆盖值和运行时的修改都不进入快照,加载时按FILE来源发布
+     * 文件头中保存配置目录下所有yaml文件的哈希、可执行文件的标识和已注册配置项集合的哈希,
+     * 任何一个变化后快照失效(换了程序版本之后不会沿用旧快照)
+     * 只会设置加载快照时已经注册的配置项,快照应在所有配置项注册(Config::lookup)之后加载
+     */
+    struct ConfigSnapshotHeader
+    {
+        char magic[8];        //"BLSKCONF"
+        uint32_t version;
+        uint32_t count;       //配置项个数
+        uint64_t source_hash; //配置文件的哈希
+        uint64_t binary_hash; //可执行文件的路径、修改时间和大小的哈希
+        uint64_t vars_hash;   //已注册配置项名称和类型的哈希
+        uint64_t data_offset; //数据区的偏移
+    };
+
+    struct ConfigSnapshotEntry
+    {
+        uint64_t name_hash;
+        uint64_t type_hash;
+        uint64_t offset; //相对数据区的偏移
+        uint32_t size;
+        uint32_t binary; //1:二进制表示 0:字符串
+    };
+
+    class ConfigSnapshot
+    {
+    public:
+        //计算目录下所有.yml/.yaml文件(路径和内容)的哈希
+        static uint64_t source_hash(const std::string &dir);
+
+        //保存最近一次Config::load_from_dir(dir)得到的文件层的值
+        static bool save(const std::string &file, const std::string &dir);
+
+        //快照存在且与dir中的配置文件一致时加载快照并返回true
+        static bool load(const std::string &file, const std::string &dir);
+
+        //优先加载快照,快照无效时从目录加载yaml并重新生成快照;配置文件加载失败时不生成快照,返回false
+        static bool load_or_build(const std::string &file, const std::string &dir);
+    };
+
+} //end of namespace
+
+#endif
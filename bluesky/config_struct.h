@@ -0,0 +1,119 @@
+#ifndef __BLUESKY_CONFIG_STRUCT_H__
+#define __BLUESKY_CONFIG_STRUCT_H__
+
+#include "config.h"
+
+/* 把普通结构体绑定到一个配置子树,编译期生成结构体与YAML之间的双向转换
+ *  struct ServerConf
+ *  {
+ *      int port = 80;
+ *      std::string ip = "0.0.0.0";
+ *      std::vector<int> backlog;
+ *  };
+ *  BLUESKY_CONFIG_STRUCT(ServerConf, port, ip, backlog)
+ *
+ *  static auto g_server = bluesky::Config::lookup("server", ServerConf(), "server");
+ *  std::shared_ptr<const ServerConf> conf = g_server->get_snapshot();
+ *
+ * 整个结构体是一个配置项,加载时作为一个值校验和发布,读者通过一次get_snapshot取得所有字段的一致快照,
+ * 不需要为每个字段单独定义配置项再逐个读取。
+ * 字段按名称对应子树中的键:缺少的键取结构体默认构造时的值,多余的键忽略;
+ * 字段类型可以是任何支持FromNode/ToNode的类型,包括另一个绑定过的结构体。
+ * 宏生成bluesky命名空间中的特化,需要在全局作用域使用,命名空间中的结构体写完整的限定名称;最多16个字段
+ */
+#define BLUESKY_CONFIG_STRUCT(Type, ...) \
+    namespace bluesky \
+    { \
+        template <> \
+        class FromNode<Type> \
+        { \
+        public: \
+            Type operator()(const YAML::Node &node) \
+            { \
+                if (!node.IsMap()) \
+                { \
+                    throw std::invalid_argument(#Type " requires a map"); \
+                } \
+                Type value = Type(); \
+                BLUESKY_CONFIG_FOR_EACH(BLUESKY_CONFIG_FROM_NODE, Type, __VA_ARGS__) \
+                return value; \
+            } \
+        }; \
+        template <> \
+        class ToNode<Type> \
+        { \
+        public: \
+            YAML::Node operator()(const Type &value) \
+            { \
+                YAML::Node node(YAML::NodeType::Map); \
+                BLUESKY_CONFIG_FOR_EACH(BLUESKY_CONFIG_TO_NODE, Type, __VA_ARGS__) \
+                return node; \
+            } \
+        }; \
+        template <> \
+        class LexicalCast<std::string, Type> \
+        { \
+        public: \
+            Type operator()(const std::string &v) \
+            { \
+                return FromNode<Type>()(YAML::Load(v)); \
+            } \
+        }; \
+        template <> \
+        class LexicalCast<Type, std::string> \
+        { \
+        public: \
+            std::string operator()(const Type &v) \
+            { \
+                std::stringstream ss; \
+                ss << ToNode<Type>()(v); \
+                return ss.str(); \
+            } \
+        }; \
+        template <> \
+        class ConfigEqual<Type> \
+        { \
+        public: \
+            bool operator()(const Type &lhs, const Type &rhs) \
+            { \
+                return true BLUESKY_CONFIG_FOR_EACH(BLUESKY_CONFIG_EQUAL, Type, __VA_ARGS__); \
+            } \
+        }; \
+    }
+
+//以下为BLUESKY_CONFIG_STRUCT的实现细节
+#define BLUESKY_CONFIG_FROM_NODE(Type, field) \
+    if (node[#field].IsDefined()) \
+    { \
+        value.field = FromNode<decltype(value.field)>()(node[#field]); \
+    }
+
+#define BLUESKY_CONFIG_TO_NODE(Type, field) \
+    node.force_insert(#field, ToNode<decltype(value.field)>()(value.field));
+
+#define BLUESKY_CONFIG_EQUAL(Type, field) \
+    &&ConfigEqual<decltype(lhs.field)>()(lhs.field, rhs.field)
+
+//对每个字段展开F(Type, field)
+#define BLUESKY_CONFIG_EXPAND(x) x
+#define BLUESKY_CONFIG_FE_1(F, T, a) F(T, a)
+#define BLUESKY_CONFIG_FE_2(F, T, a, ...) F(T, a) BLUESKY_CONFIG_EXPAND(BLUESKY_CONFIG_FE_1(F, T, __VA_ARGS__))
+#define BLUESKY_CONFIG_FE_3(F, T, a, ...) F(T, a) BLUESKY_CONFIG_EXPAND(BLUESKY_CONFIG_FE_2(F, T, __VA_ARGS__))
+#define BLUESKY_CONFIG_FE_4(F, T, a, ...) F(T, a) BLUESKY_CONFIG_EXPAND(BLUESKY_CONFIG_FE_3(F, T, __VA_ARGS__))
+#define BLUESKY_CONFIG_FE_5(F, T, a, ...) F(T, a) BLUESKY_CONFIG_EXPAND(BLUESKY_CONFIG_FE_4(F, T, __VA_ARGS__))
+#define BLUESKY_CONFIG_FE_6(F, T, a, ...) F(T, a) BLUESKY_CONFIG_EXPAND(BLUESKY_CONFIG_FE_5(F, T, __VA_ARGS__))
+#define BLUESKY_CONFIG_FE_7(F, T, a, ...) F(T, a) BLUESKY_CONFIG_EXPAND(BLUESKY_CONFIG_FE_6(F, T, __VA_ARGS__))
+#define BLUESKY_CONFIG_FE_8(F, T, a, ...) F(T, a) BLUESKY_CONFIG_EXPAND(BLUESKY_CONFIG_FE_7(F, T, __VA_ARGS__))
+#define BLUESKY_CONFIG_FE_9(F, T, a, ...) F(T, a) BLUESKY_CONFIG_EXPAND(BLUESKY_CONFIG_FE_8(F, T, __VA_ARGS__))
+#define BLUESKY_CONFIG_FE_10(F, T, a, ...) F(T, a) BLUESKY_CONFIG_EXPAND(BLUESKY_CONFIG_FE_9(F, T, __VA_ARGS__))
+#define BLUESKY_CONFIG_FE_11(F, T, a, ...) F(T, a) BLUESKY_CONFIG_EXPAND(BLUESKY_CONFIG_FE_10(F, T, __VA_ARGS__))
+#define BLUESKY_CONFIG_FE_12(F, T, a, ...) F(T, a) BLUESKY_CONFIG_EXPAND(BLUESKY_CONFIG_FE_11(F, T, __VA_ARGS__))
+#define BLUESKY_CONFIG_FE_13(F, T, a, ...) F(T, a) BLUESKY_CONFIG_EXPAND(BLUESKY_CONFIG_FE_12(F, T, __VA_ARGS__))
+#define BLUESKY_CONFIG_FE_14(F, T, a, ...) F(T, a) BLUESKY_CONFIG_EXPAND(BLUESKY_CONFIG_FE_13(F, T, __VA_ARGS__))
+#define BLUESKY_CONFIG_FE_15(F, T, a, ...) F(T, a) BLUESKY_CONFIG_EXPAND(BLUESKY_CONFIG_FE_14(F, T, __VA_ARGS__))
+#define BLUESKY_CONFIG_FE_16(F, T, a, ...) F(T, a) BLUESKY_CONFIG_EXPAND(BLUESKY_CONFIG_FE_15(F, T, __VA_ARGS__))
+#define BLUESKY_CONFIG_FE_N(_1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13, _14, _15, _16, N, ...) N
+#define BLUESKY_CONFIG_FOR_EACH(F, T, ...) \
+    BLUESKY_CONFIG_EXPAND(BLUESKY_CONFIG_FE_N(__VA_ARGS__, BLUESKY_CONFIG_FE_16, BLUESKY_CONFIG_FE_15, BLUESKY_CONFIG_FE_14, BLUESKY_CONFIG_FE_13, BLUESKY_CONFIG_FE_12, BLUESKY_CONFIG_FE_11, BLUESKY_CONFIG_FE_10, BLUESKY_CONFIG_FE_9, BLUESKY_CONFIG_FE_8, BLUESKY_CONFIG_FE_7, BLUESKY_CONFIG_FE_6, BLUESKY_CONFIG_FE_5, BLUESKY_CONFIG_FE_4, BLUESKY_CONFIG_FE_3, BLUESKY_CONFIG_FE_2, BLUESKY_CONFIG_FE_1)(F, T, __VA_ARGS__))
+
+#endif
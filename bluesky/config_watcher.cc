@@ -0,0 +1,174 @@
+#include "config_watcher.h"
+#include <sys/inotify.h>
+#include <sys/eventfd.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <poll.h>
+#include <string.h>
+#include <errno.h>
+
+namespace bluesky
+{
+    static const uint32_t s_watch_mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM |
+                                         IN_CREATE | IN_DELETE | IN_DELETE_SELF;
+
+    ConfigWatcher::ConfigWatcher(const std::string &path, uint32_t debounce_ms)
+        : path_(path), debounce_ms_(debounce_ms)
+    {
+    }
+
+    ConfigWatcher::~ConfigWatcher()
+    {
+        stop();
+    }
+
+    bool ConfigWatcher::start()
+    {
+        if (thread_)
+        {
+            return true;
+        }
+        inotify_fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        event_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (inotify_fd_ < 0 || event_fd_ < 0)
+        {
+            BLUESKY_LOG_ERROR(BLUESKY_LOG_ROOT()) << "ConfigWatcher init failed: " << strerror(errno);
+            stop();
+            return false;
+        }
+        add_watches(path_);
+        if (watches_.empty())
+        {
+            BLUESKY_LOG_ERROR(BLUESKY_LOG_ROOT()) << "ConfigWatcher watch path failed: " << path_;
+            stop();
+            return false;
+        }
+        stopping_ = false;
+        thread_.reset(new Thread(std::bind(&ConfigWatcher::run, this), "config_watcher"));
+        return true;
+    }
+
+    void ConfigWatcher::stop()
+    {
+        stopping_ = true;
+        if (thread_)
+        {
+            uint64_t one = 1;
+            if (write(event_fd_, &one, sizeof(one)) < 0)
+            {
+                BLUESKY_LOG_ERROR(BLUESKY_LOG_ROOT()) << "ConfigWatcher wakeup failed: " << strerror(errno);
+            }
+            thread_->join();
+            thread_.reset();
+        }
+        if (inotify_fd_ >= 0)
+        {
+            close(inotify_fd_);
+            inotify_fd_ = -1;
+        }
+        if (event_fd_ >= 0)
+        {
+            close(event_fd_);
+            event_fd_ = -1;
+        }
+        watches_.clear();
+    }
+
+    void ConfigWatcher::add_watches(const std::string &path)
+    {
+        int wd = inotify_add_watch(inotify_fd_, path.c_str(), s_watch_mask);
+        if (wd < 0)
+        {
+            return;
+        }
+        watches_[wd] = path;
+        DIR *dir = opendir(path.c_str());
+        if (!dir)
+        {
+            return;
+        }
+        struct dirent *dp = nullptr;
+        while ((dp = readdir(dir)) != nullptr)
+        {
+            if (!strcmp(dp->d_name, ".") || !strcmp(dp->d_name, ".."))
+            {
+                continue;
+            }
+            std::string sub = path + "/" + dp->d_name;
+            struct stat st;
+            if (stat(sub.c_str(), &st) == 0 && S_ISDIR(st.st_mode))
+            {
+                add_watches(sub);
+            }
+        }
+        closedir(dir);
+    }
+
+    void ConfigWatcher::run()
+    {
+        char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+        bool pending = false;
+        bool rescan = false;
+        while (!stopping_)
+        {
+            struct pollfd fds[2];
+            fds[0].fd = inotify_fd_;
+            fds[0].events = POLLIN;
+            fds[1].fd = event_fd_;
+            fds[1].events = POLLIN;
+            //有未处理的变化时,等待debounce_ms没有新的变化才加载
+            int rt = poll(fds, 2, pending ? (int)debounce_ms_ : -1);
+            if (rt < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                BLUESKY_LOG_ERROR(BLUESKY_LOG_ROOT()) << "ConfigWatcher poll failed: " << strerror(errno);
+                break;
+            }
+            if (stopping_)
+            {
+                break;
+            }
+            if (rt == 0)
+            {
+                if (rescan)
+                {
+                    for (auto &watch : watches_)
+                    {
+                        inotify_rm_watch(inotify_fd_, watch.first);
+                    }
+                    watches_.clear();
+                    add_watches(path_);
+                    rescan = false;
+                }
+                size_t files = Config::load_from_dir(path_);
+                ++reloads_;
+                BLUESKY_LOG_INFO(BLUESKY_LOG_ROOT()) << "ConfigWatcher reload path=" << path_ << " changed files=" << files;
+                pending = false;
+                continue;
+            }
+            ssize_t len;
+            while ((len = read(inotify_fd_, buf, sizeof(buf))) > 0)
+            {
+                for (char *ptr = buf; ptr < buf + len;)
+                {
+                    const struct inotify_event *event = (const struct inotify_event *)ptr;
+                    ptr += sizeof(struct inotify_event) + event->len;
+                    if (event->mask == IN_IGNORED)
+                    {
+                        //重新添加监听时移除旧监听产生的事件
+                        continue;
+                    }
+                    if (event->mask & (IN_ISDIR | IN_DELETE_SELF))
+                    {
+                        rescan = true;
+                    }
+                    pending = true;
+                }
+            }
+        }
+    }
+
+} //end of namespace
@@ -0,0 +1,49 @@
+#ifndef __BLUESKY_CONFIG_WATCHER_H__
+#define __BLUESKY_CONFIG_WATCHER_H__
+
+#include "config.h"
+#include "thread.h"
+#include <atomic>
+
+namespace bluesky
+{
+    /* 配置热加载:后台线程通过inotify监听配置目录(含子目录)
+     * 一段时间内连续的文件变化只触发一次加载(debounce),加载通过Config::load_from_dir完成,
+     * 只有内容真正变化的配置项会被重新设置,没有变化的配置项不会触发监听回调
+     */
+    class ConfigWatcher
+    {
+    public:
+        typedef std::shared_ptr<ConfigWatcher> Ptr;
+
+        //debounce_ms: 最后一次文件变化之后等待的毫秒数
+        ConfigWatcher(const std::string &path, uint32_t debounce_ms = 200);
+        ~ConfigWatcher();
+
+        //开始监听,inotify初始化失败时返回false
+        bool start();
+        void stop();
+
+        const std::string &get_path() const { return path_; }
+        //已经执行的重新加载次数
+        uint64_t get_reloads() const { return reloads_; }
+
+    private:
+        void run();
+        //为目录及其子目录添加监听,新建的子目录在下一次加载前补上
+        void add_watches(const std::string &path);
+
+    private:
+        std::string path_;
+        uint32_t debounce_ms_;
+        int inotify_fd_ = -1;
+        int event_fd_ = -1;
+        std::map<int, std::string> watches_;
+        std::atomic<bool> stopping_{false};
+        std::atomic<uint64_t> reloads_{0};
+        Thread::Ptr thread_;
+    };
+
+} //end of namespace
+
+#endif
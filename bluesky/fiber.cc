@@ -12,8 +12,12 @@ namespace bluesky
     //主协程,切换到这个协程就相当于切换到主线程中运行
     static thread_local Fiber::Ptr tMainFiber = nullptr;
 
-    static ConfigVar<uint32_t>::Ptr g_fiber_stack_size =
-        Config::lookup<uint32_t>("fiber.stack_size", 1024 * 1024, "fiber stack size");
+    //静态初始化阶段只挂到待注册链表上,第一次访问配置注册表时才注册
+    static ConfigStatic<uint32_t> g_fiber_stack_size("fiber.stack_size", 1024 * 1024,
+                                                     ConfigRule<uint32_t>().min(16 * 1024).max(64 * 1024 * 1024),
+                                                     "fiber stack size");
+    //每个协程创建时都要读取,使用线程局部缓存
+    static ConfigCached<uint32_t> g_fiber_stack_size_cached(g_fiber_stack_size);
 
     class MallocStackAllocator
     {
@@ -47,7 +51,7 @@ namespace bluesky
     {
         sFiberCount++;
         //1:分配空间
-        stacksize_ = stacksize ? stacksize_ : g_fiber_stack_size->get_value();
+        stacksize_ = stacksize ? stacksize : g_fiber_stack_size_cached.get();
         stack_ = StackAllocator::Alloc(stacksize_);
         state_ = INIT;
         if(getcontext(&ctx_)){
@@ -2,12 +2,17 @@
 #define __LOCKER_H__
 
 #include <stdint.h>
+#include <stdexcept>
 #include <pthread.h>
 #include <semaphore.h>
 #include <atomic>
 #include <thread>
 #include <memory>
 #include <boost/noncopyable.hpp>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
 
 namespace bluesky
 {
@@ -83,7 +88,7 @@ namespace bluesky
         {
             if (locked_)
             {
-                mutex_.lock();
+                mutex_.unlock();
                 locked_ = false;
             }
         }
@@ -93,13 +98,14 @@ namespace bluesky
         bool locked_;
     };
 
+    //读锁守卫,析构时通过rdunlock释放
     template <class T>
     struct ReadScopedLockImpl : boost::noncopyable
     {
     public:
         ReadScopedLockImpl(T &mutex) : mutex_(mutex)
         {
-            mutex.rdlock();
+            mutex_.rdlock();
             locked_ = true;
         }
         ~ReadScopedLockImpl()
@@ -116,9 +122,9 @@ namespace bluesky
         }
         void unlock()
         {
-            if (!locked_)
+            if (locked_)
             {
-                mutex_.unlock();
+                mutex_.rdunlock();
                 locked_ = false;
             }
         }
@@ -128,13 +134,14 @@ namespace bluesky
         bool locked_;
     };
 
+    //写锁守卫,析构时通过wrunlock释放
     template <class T>
-    struct WriteScopedLockImpl
+    struct WriteScopedLockImpl : boost::noncopyable
     {
     public:
         WriteScopedLockImpl(T &mutex) : mutex_(mutex)
         {
-            mutex.rdlock();
+            mutex_.wrlock();
             locked_ = true;
         }
         ~WriteScopedLockImpl()
@@ -145,15 +152,15 @@ namespace bluesky
         {
             if (!locked_)
             {
-                mutex_.rdlock();
+                mutex_.wrlock();
                 locked_ = true;
             }
         }
         void unlock()
         {
-            if (!locked_)
+            if (locked_)
             {
-                mutex_.unlock();
+                mutex_.wrunlock();
                 locked_ = false;
             }
         }
@@ -211,6 +218,155 @@ namespace bluesky
         void unlock() {}
     };
 
+    //自旋等待时提示CPU降低功耗、让出流水线给同核的另一个超线程
+    inline void cpu_relax()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#elif defined(__aarch64__)
+        asm volatile("yield" ::: "memory");
+#else
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+#endif
+    }
+
+    /* 自旋锁(test-and-test-and-set)
+     * 先只读等待锁被释放,再尝试交换,等待期间不会反复写同一条缓存行;
+     * 每次失败后pause的次数指数增长,超过上限后sched_yield让出CPU。
+     * 适合临界区很短、几乎不会阻塞的场景,持有锁期间不能做IO
+     */
+    class Spinlock : boost::noncopyable
+    {
+    public:
+        typedef ScopedLockImpl<Spinlock> Lock;
+
+        Spinlock() {}
+
+        void lock()
+        {
+            uint32_t backoff = 1;
+            while (true)
+            {
+                if (!locked_.exchange(true, std::memory_order_acquire))
+                {
+                    return;
+                }
+                while (locked_.load(std::memory_order_relaxed))
+                {
+                    if (backoff <= kMaxBackoff)
+                    {
+                        for (uint32_t i = 0; i < backoff; i++)
+                        {
+                            cpu_relax();
+                        }
+                        backoff <<= 1;
+                    }
+                    else
+                    {
+                        sched_yield();
+                    }
+                }
+            }
+        }
+
+        bool try_lock()
+        {
+            return !locked_.load(std::memory_order_relaxed) && !locked_.exchange(true, std::memory_order_acquire);
+        }
+
+        void unlock()
+        {
+            locked_.store(false, std::memory_order_release);
+        }
+
+    private:
+        static const uint32_t kMaxBackoff = 1024;
+        std::atomic<bool> locked_{false};
+    };
+
+    /* 最简单的CAS自旋锁:循环test_and_set直到成功,不退避
+     * 竞争激烈时所有等待者反复写同一条缓存行,只用作对比基准或者几乎没有竞争的场景
+     */
+    class CASLock : boost::noncopyable
+    {
+    public:
+        typedef ScopedLockImpl<CASLock> Lock;
+
+        CASLock()
+        {
+            flag_.clear();
+        }
+
+        void lock()
+        {
+            while (flag_.test_and_set(std::memory_order_acquire))
+            {
+            }
+        }
+
+        void unlock()
+        {
+            flag_.clear(std::memory_order_release);
+        }
+
+    private:
+        std::atomic_flag flag_;
+    };
+
+    /* 自适应互斥量:先自旋一小段时间,仍然拿不到锁再通过futex睡眠
+     * 状态: 0 未加锁, 1 加锁且没有等待者, 2 加锁且可能有等待者;
+     * 没有竞争时加锁和解锁都只有一次原子操作,只有状态为2时解锁才需要系统调用唤醒等待者
+     */
+    class AdaptiveMutex : boost::noncopyable
+    {
+    public:
+        typedef ScopedLockImpl<AdaptiveMutex> Lock;
+
+        AdaptiveMutex() {}
+
+        void lock()
+        {
+            int state = 0;
+            if (state_.compare_exchange_strong(state, 1, std::memory_order_acquire))
+            {
+                return;
+            }
+            for (uint32_t i = 0; i < kSpinCount; i++)
+            {
+                cpu_relax();
+                state = 0;
+                if (state_.load(std::memory_order_relaxed) == 0 &&
+                    state_.compare_exchange_weak(state, 1, std::memory_order_acquire))
+                {
+                    return;
+                }
+            }
+            //标记有等待者后睡眠,被唤醒后重新抢锁,抢到时状态保持为2,解锁时再唤醒下一个
+            while (state_.exchange(2, std::memory_order_acquire) != 0)
+            {
+                syscall(SYS_futex, (int *)&state_, FUTEX_WAIT_PRIVATE, 2, nullptr, nullptr, 0);
+            }
+        }
+
+        bool try_lock()
+        {
+            int state = 0;
+            return state_.compare_exchange_strong(state, 1, std::memory_order_acquire);
+        }
+
+        void unlock()
+        {
+            if (state_.exchange(0, std::memory_order_release) == 2)
+            {
+                syscall(SYS_futex, (int *)&state_, FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+            }
+        }
+
+    private:
+        static const uint32_t kSpinCount = 100;
+        std::atomic<int> state_{0};
+    };
+
     class MutexGuard : boost::noncopyable
     {
     public:
@@ -227,15 +383,30 @@ namespace bluesky
         Mutex &mutex_;
     };
 
+    /* 封装读写锁
+     * prefer_writer为true时有写者等待期间新的读者也会等待,读多写少时写者不会一直拿不到锁;
+     * 这种模式下同一个线程不能递归加读锁(中间有写者排队时会死锁)
+     */
     class RWMutex : boost::noncopyable
     {
     public:
         typedef ReadScopedLockImpl<RWMutex> ReadLock;
         typedef WriteScopedLockImpl<RWMutex> WriteLock;
 
-        RWMutex()
+        RWMutex(bool prefer_writer = false)
         {
-            pthread_rwlock_init(&lock_, NULL);
+            pthread_rwlockattr_t attr;
+            pthread_rwlockattr_init(&attr);
+            if (prefer_writer)
+            {
+                pthread_rwlockattr_setkind_np(&attr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+            }
+            int ret = pthread_rwlock_init(&lock_, &attr);
+            pthread_rwlockattr_destroy(&attr);
+            if (ret != 0)
+            {
+                throw std::logic_error("RWMutex::pthread_rwlock_init error");
+            }
         }
         ~RWMutex()
         {
@@ -243,26 +414,133 @@ namespace bluesky
         }
         void rdlock()
         {
-            pthread_rwlock_rdlock(&lock_);
+            if (pthread_rwlock_rdlock(&lock_))
+            {
+                throw std::logic_error("RWMutex::pthread_rwlock_rdlock error");
+            }
         }
         void wrlock()
         {
-            pthread_rwlock_wrlock(&lock_);
+            if (pthread_rwlock_wrlock(&lock_))
+            {
+                throw std::logic_error("RWMutex::pthread_rwlock_wrlock error");
+            }
         }
         void unlock()
         {
-            pthread_rwlock_unlock(&lock_);
+            if (pthread_rwlock_unlock(&lock_))
+            {
+                throw std::logic_error("RWMutex::pthread_rwlock_unlock error");
+            }
         }
+        void rdunlock() { unlock(); }
+        void wrunlock() { unlock(); }
 
     private:
         pthread_rwlock_t lock_;
     };
 
+    /* 分片读写锁,用于读非常多、写很少的数据
+     * 每个线程固定使用一个分片的读者计数(线程第一次加读锁时轮流分配),每个分片独占一个缓存行,
+     * 不同线程加读锁时一般写不同的缓存行,不会像RWMutex那样所有读者争抢同一个计数器。
+     * 没有按CPU(sched_getcpu)分片:线程在加锁和解锁之间可能迁移到其他CPU,解锁时必须找回加锁的分片,
+     * 按线程分片不需要记录,线程数不超过分片数时效果与按CPU分片相同。
+     * 写者先置位写标志,再等待所有分片的读者计数归零;写标志置位期间新的读者让出,天然是写者优先。
+     * 写锁的代价与分片数成正比,写锁期间读者自旋/让出CPU等待,写临界区应当很短;不支持递归加读锁
+     */
+    class ShardedRWMutex : boost::noncopyable
+    {
+    public:
+        typedef ReadScopedLockImpl<ShardedRWMutex> ReadLock;
+        typedef WriteScopedLockImpl<ShardedRWMutex> WriteLock;
+
+        ShardedRWMutex() {}
+
+        void rdlock()
+        {
+            std::atomic<int32_t> &readers = shards_[get_shard()].readers;
+            while (true)
+            {
+                //先登记再检查写标志,与wrlock中先置位再检查计数对应,两边都用顺序一致的原子操作
+                readers.fetch_add(1, std::memory_order_seq_cst);
+                if (!writer_.load(std::memory_order_seq_cst))
+                {
+                    return;
+                }
+                readers.fetch_sub(1, std::memory_order_release);
+                for (uint32_t i = 0; writer_.load(std::memory_order_relaxed); i++)
+                {
+                    pause(i);
+                }
+            }
+        }
+
+        void rdunlock()
+        {
+            shards_[get_shard()].readers.fetch_sub(1, std::memory_order_release);
+        }
+
+        void wrlock()
+        {
+            writerMutex_.lock();
+            writer_.store(true, std::memory_order_seq_cst);
+            for (auto &shard : shards_)
+            {
+                for (uint32_t i = 0; shard.readers.load(std::memory_order_seq_cst) != 0; i++)
+                {
+                    pause(i);
+                }
+            }
+        }
+
+        void wrunlock()
+        {
+            writer_.store(false, std::memory_order_release);
+            writerMutex_.unlock();
+        }
+
+    private:
+        static const size_t kShards = 32;
+        static const uint32_t kSpinCount = 64;
+
+        //对齐到缓存行,相邻分片的计数器不会伪共享
+        struct alignas(64) Shard
+        {
+            std::atomic<int32_t> readers{0};
+        };
+        static_assert(sizeof(Shard) == 64, "ShardedRWMutex::Shard must occupy one cache line");
+
+        //第i次等待:先自旋,之后让出CPU
+        static void pause(uint32_t i)
+        {
+            if (i < kSpinCount)
+            {
+                cpu_relax();
+            }
+            else
+            {
+                sched_yield();
+            }
+        }
+
+        static size_t get_shard()
+        {
+            static std::atomic<size_t> s_next{0};
+            static thread_local size_t t_shard = s_next.fetch_add(1, std::memory_order_relaxed) % kShards;
+            return t_shard;
+        }
+
+    private:
+        Shard shards_[kShards];
+        std::atomic<bool> writer_{false};
+        Mutex writerMutex_;
+    };
+
     class NullRWMutex
     {
     public:
-        typedef ReadScopedLockImpl<NullMutex> ReadLock;
-        typedef WriteScopedLockImpl<NullMutex> WriteLock;
+        typedef ReadScopedLockImpl<NullRWMutex> ReadLock;
+        typedef WriteScopedLockImpl<NullRWMutex> WriteLock;
 
         NullRWMutex() {}
         ~NullRWMutex() {}
@@ -270,6 +548,8 @@ namespace bluesky
         void rdlock() {}
         void wrlock() {}
         void unlock() {}
+        void rdunlock() {}
+        void wrunlock() {}
     };
 
     /* 封装条件变量类 */
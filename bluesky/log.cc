@@ -2,6 +2,7 @@
 #include "config.h"
 #include <yaml-cpp/yaml.h>
 #include <algorithm>
+#include <sys/stat.h>
 namespace bluesky
 {
     /*-------------LoggerManager---------------*/
@@ -15,8 +16,16 @@ namespace bluesky
 
     std::shared_ptr<Logger> LoggerManager::get_logger(const std::string &name)
     {
-        MutexType::Lock lock(mutex_);
-
+        //每次通过名称写日志都会查找,已经存在的日志器只加读锁
+        {
+            MutexType::ReadLock lock(mutex_);
+            auto iter = loggers_.find(name);
+            if (iter != loggers_.end())
+            {
+                return iter->second;
+            }
+        }
+        MutexType::WriteLock lock(mutex_);
         auto iter = loggers_.find(name);
         if (iter != loggers_.end())
         {
@@ -32,7 +41,7 @@ namespace bluesky
     {
         YAML::Node node;
 
-        MutexType::Lock lock(mutex_);
+        MutexType::ReadLock lock(mutex_);
         for (auto &logger : loggers_)
         {
             node.push_back(YAML::Load(logger.second->toYamlString()));
@@ -42,6 +51,24 @@ namespace bluesky
         return ss.str();
     }
 
+    std::vector<LogMetricsSnapshot> LoggerManager::get_metrics()
+    {
+        std::vector<std::shared_ptr<Logger>> loggers;
+        {
+            MutexType::ReadLock lock(mutex_);
+            for (auto &logger : loggers_)
+            {
+                loggers.push_back(logger.second);
+            }
+        }
+        std::vector<LogMetricsSnapshot> result;
+        for (auto &logger : loggers)
+        {
+            result.push_back(logger->get_metrics());
+        }
+        return result;
+    }
+
     void LoggerManager::init()
     {
         loggers_[root_->get_name()] = get_root();
@@ -49,6 +76,24 @@ namespace bluesky
 
     /*-----------LoggerManager End-------------*/
 
+    static YAML::Node metrics_to_yaml(const LogMetricsSnapshot &snap)
+    {
+        YAML::Node node;
+        for (size_t i = LogLevel::DEBUG; i < LogMetricsSnapshot::LEVELS; i++)
+        {
+            node["lines"][LogLevel::to_string((LogLevel::Level)i)] = snap.lines[i];
+        }
+        node["bytes"] = snap.bytes;
+        node["suppressed"] = snap.suppressed;
+        node["dropped"] = snap.dropped;
+        node["latency_ns"]["count"] = snap.latency_count;
+        node["latency_ns"]["avg"] = snap.latency_count ? snap.latency_sum / snap.latency_count : 0;
+        node["latency_ns"]["p50"] = snap.percentile(0.5);
+        node["latency_ns"]["p99"] = snap.percentile(0.99);
+        node["latency_ns"]["max"] = snap.latency_max;
+        return node;
+    }
+
     /*--------------Logger Level--------------*/
     std::string LogLevel::to_string(LogLevel::Level level)
     {
@@ -80,31 +125,27 @@ namespace bluesky
     LogLevel::Level LogLevel::from_string(std::string &str_level)
     {
         std::transform(str_level.begin(), str_level.end(), str_level.begin(), ::tolower);
-        if (str_level.compare("unknow") || str_level.compare("UNKNOW"))
-        {
-            return LogLevel::Level::UNKNOW;
-        }
-        if (str_level.compare("debug") || str_level.compare("DEBUG"))
+        if (str_level == "debug")
         {
             return LogLevel::Level::DEBUG;
         }
-        if (str_level.compare("info") || str_level.compare("INFO"))
+        if (str_level == "info")
         {
             return LogLevel::Level::INFO;
         }
-        if (str_level.compare("warn") || str_level.compare("WARN"))
+        if (str_level == "warn")
         {
             return LogLevel::Level::WARN;
         }
-        if (str_level.compare("error") || str_level.compare("ERROR"))
+        if (str_level == "error")
         {
             return LogLevel::Level::ERROR;
         }
-        if (str_level.compare("fatal") || str_level.compare("FATAL"))
+        if (str_level == "fatal")
         {
             return LogLevel::Level::FATAL;
         }
-        return LogLevel::Level::DEBUG;
+        return LogLevel::Level::UNKNOW;
     }
     /*------------Logger Level End------------*/
 
@@ -165,23 +206,68 @@ namespace bluesky
 
     void Logger::log(LogLevel::Level level, const std::shared_ptr<LogEvent> event)
     {
-        if (level >= level_)
+        if (level < level_)
+        {
+            metrics_.add_suppressed();
+            return;
+        }
+        uint64_t begin = get_current_ns();
+        //至少一个appender写入时才计入Logger的输出,全部被过滤或者丢弃的日志只在各个appender中统计
+        bool written = false;
         {
             auto self = shared_from_this();
 
             MutexType::Lock lock(mutex_);
-            if (!appenders_.empty())
+            if (shared_format_ && appenders_.size() > 1)
+            {
+                //按formatter的pattern缓存格式化结果,相同格式的appender只格式化一次
+                std::vector<std::pair<LogFormatter::Ptr, std::string>> rendered;
+                for (auto &app : appenders_)
+                {
+                    if (!app->accept(level, *event))
+                    {
+                        continue;
+                    }
+                    LogFormatter::Ptr fmt = app->get_formatter();
+                    if (!fmt)
+                    {
+                        continue;
+                    }
+                    const std::string *content = nullptr;
+                    for (auto &r : rendered)
+                    {
+                        if (r.first == fmt || r.first->get_pattern() == fmt->get_pattern())
+                        {
+                            content = &r.second;
+                            break;
+                        }
+                    }
+                    if (!content)
+                    {
+                        rendered.push_back(std::make_pair(fmt, fmt->format(self, level, event)));
+                        content = &rendered.back().second;
+                    }
+                    written |= app->log_formatted(level, *content);
+                }
+            }
+            else if (!appenders_.empty())
             {
                 for (auto &app : appenders_)
                 {
-                    app->log(self, level, event);
+                    written |= app->log(self, level, event);
                 }
             }
-            else if (root_)
+            else if (root_ && root_->accept(level, event->get_filename().c_str(), event->get_line()))
             {
                 root_->log(level, event);
+                written = true;
             }
         }
+        if (written)
+        {
+            metrics_.add_line(level, 0);
+            metrics_.record_latency(get_current_ns() - begin);
+        }
     }
 
     /*---------------------日志级别输入--------------*/
@@ -241,6 +327,24 @@ namespace bluesky
         appenders_.clear();
     }
 
+    void Logger::set_appenders(const std::list<std::shared_ptr<LogAppender>> &appenders)
+    {
+        std::list<std::shared_ptr<LogAppender>> old_appenders;
+        {
+            MutexType::Lock lock(mutex_);
+            for (auto &appender : appenders)
+            {
+                if (!appender->get_formatter())
+                {
+                    appender->set_formatter(formatter_);
+                }
+            }
+            old_appenders.swap(appenders_);
+            appenders_ = appenders;
+        }
+        //被替换下来的appender在锁外释放,关闭文件或者等待异步队列不会阻塞写日志的线程
+    }
+
     void Logger::set_formatter(std::shared_ptr<LogFormatter> &formatter)
     {
         MutexType::Lock lock(mutex_);
@@ -276,6 +380,32 @@ namespace bluesky
         return formatter_;
     }
 
+    void Logger::set_filter(LogFilter::Ptr filter)
+    {
+        std::atomic_store(&filter_, filter);
+    }
+
+    LogFilter::Ptr Logger::get_filter()
+    {
+        return std::atomic_load(&filter_);
+    }
+
+    bool Logger::accept(LogLevel::Level level, const char *file, int32_t line)
+    {
+        LogFilter::Ptr filter = std::atomic_load(&filter_);
+        if (!filter)
+        {
+            return true;
+        }
+        LogFilterFields fields = {name_, file, line, get_threadID(), get_fiberID()};
+        if (!filter->match(level, fields))
+        {
+            metrics_.add_suppressed();
+            return false;
+        }
+        return true;
+    }
+
     std::string Logger::toYamlString()
     {
         MutexType::Lock lock(mutex_);
@@ -289,15 +419,42 @@ namespace bluesky
         {
             node["formatter"] = formatter_->get_pattern();
         }
+        LogFilter::Ptr filter = get_filter();
+        if (filter)
+        {
+            node["filter"] = filter->get_expr();
+        }
+        //Logger本身不知道格式化后的长度,字节数与get_metrics一样取各个appender之和
+        LogMetricsSnapshot snap;
+        metrics_.snapshot(snap);
         for (auto &appender : appenders_)
         {
-            node["appender"].push_back(YAML::Load(appender->toYamlString()));
+            LogMetricsSnapshot app_snap = appender->get_metrics();
+            YAML::Node app_node = YAML::Load(appender->toYamlString());
+            app_node["metrics"] = metrics_to_yaml(app_snap);
+            node["appender"].push_back(app_node);
+            snap.bytes += app_snap.bytes;
         }
+        node["metrics"] = metrics_to_yaml(snap);
         std::stringstream ss;
         ss << node;
         return ss.str();
     }
 
+    LogMetricsSnapshot Logger::get_metrics()
+    {
+        LogMetricsSnapshot snap;
+        snap.name = name_;
+        metrics_.snapshot(snap);
+        MutexType::Lock lock(mutex_);
+        for (auto &appender : appenders_)
+        {
+            snap.appenders.push_back(appender->get_metrics());
+            snap.bytes += snap.appenders.back().bytes;
+        }
+        return snap;
+    }
+
     /*------------------Logger End--------------*/
 
     /*------------------Appender----------------*/
@@ -321,13 +478,78 @@ namespace bluesky
         return formatter_;
     }
 
-    void StdoutLogAppender::log(std::shared_ptr<Logger> logger, LogLevel::Level level, std::shared_ptr<LogEvent> event)
+    void LogAppender::set_filter(LogFilter::Ptr filter)
+    {
+        MutexType::Lock lock(mutex_);
+        filter_ = filter;
+    }
+
+    LogFilter::Ptr LogAppender::get_filter()
     {
         MutexType::Lock lock(mutex_);
-        if (level >= level_)
+        return filter_;
+    }
+
+    bool LogAppender::accept(LogLevel::Level level, const LogEvent &event)
+    {
+        if (level < level_)
+        {
+            metrics_.add_suppressed();
+            return false;
+        }
+        LogFilter::Ptr filter = get_filter();
+        if (filter && !filter->match(level, event))
         {
-            std::cout << formatter_->format(logger, level, event);
+            metrics_.add_suppressed();
+            return false;
         }
+        return true;
+    }
+
+    bool LogAppender::log(std::shared_ptr<Logger> logger, LogLevel::Level level, std::shared_ptr<LogEvent> event)
+    {
+        if (!accept(level, *event))
+        {
+            return false;
+        }
+        std::shared_ptr<LogFormatter> formatter = get_formatter();
+        if (formatter)
+        {
+            return log_formatted(level, formatter->format(logger, level, event));
+        }
+        return false;
+    }
+
+    bool LogAppender::log_formatted(LogLevel::Level level, const std::string &content)
+    {
+        if (level < level_)
+        {
+            metrics_.add_suppressed();
+            return false;
+        }
+        uint64_t begin = get_current_ns();
+        if (!write(level, content))
+        {
+            return false;
+        }
+        metrics_.add_line(level, content.size());
+        metrics_.record_latency(get_current_ns() - begin);
+        return true;
+    }
+
+    LogMetricsSnapshot LogAppender::get_metrics() const
+    {
+        LogMetricsSnapshot snap;
+        snap.name = get_name();
+        metrics_.snapshot(snap);
+        return snap;
+    }
+
+    bool StdoutLogAppender::write(LogLevel::Level level, const std::string &content)
+    {
+        MutexType::Lock lock(mutex_);
+        std::cout << content;
+        return true;
     }
 
     std::string StdoutLogAppender::toYamlString()
@@ -343,6 +565,10 @@ namespace bluesky
         {
             node["formatter"] = formatter_->get_pattern();
         }
+        if (filter_)
+        {
+            node["filter"] = filter_->get_expr();
+        }
         std::stringstream ss;
         ss << node;
         return ss.str();
@@ -354,6 +580,10 @@ namespace bluesky
         YAML::Node node;
         node["type"] = "FileLogAppender";
         node["file"] = filename_;
+        if (indexInterval_)
+        {
+            node["index_interval"] = indexInterval_;
+        }
         if (level_ != LogLevel::UNKNOW)
         {
             node["level"] = LogLevel::to_string(level_);
@@ -362,6 +592,10 @@ namespace bluesky
         {
             node["formatter"] = formatter_->get_pattern();
         }
+        if (filter_)
+        {
+            node["filter"] = filter_->get_expr();
+        }
         std::stringstream ss;
         ss << node;
         return ss.str();
@@ -371,37 +605,206 @@ namespace bluesky
         : filename_(filename)
     {
         MutexType::Lock lock(mutex_);
-        if (!filestream_.is_open())
-        {
-            filestream_.open(filename_);
-        }
+        reopen();
     }
 
-    void FileLogAppender::log(std::shared_ptr<Logger> logger, LogLevel::Level level, std::shared_ptr<LogEvent> event)
+    FileLogAppender::~FileLogAppender()
     {
         MutexType::Lock lock(mutex_);
-        if (level >= level_)
+        close_block();
+    }
+
+    bool FileLogAppender::write(LogLevel::Level level, const std::string &content)
+    {
+        MutexType::Lock lock(mutex_);
+        uint64_t now = time(0);
+        if (now != lastTime_)
+        {
+            reopen();
+            lastTime_ = now;
+        }
+        filestream_ << content;
+        if (indexInterval_)
         {
-            uint64_t now = time(0);
-            if (now != lastTime_)
+            if (!blockOpen_)
             {
-                reopen();
-                lastTime_ = now;
+                block_.begin_time = now;
+                block_.offset = offset_;
+                block_.length = 0;
+                block_.levels = 0;
+                blockOpen_ = true;
+            }
+            block_.end_time = now;
+            block_.length += content.size();
+            block_.levels |= 1u << level;
+            if (block_.length >= indexInterval_ * 1024)
+            {
+                close_block();
             }
-            filestream_ << formatter_->format(logger, level, event);
         }
+        offset_ += content.size();
+        return true;
     }
 
+    /* 追加方式打开,文件大小作为后续日志的偏移;
+     * 如果文件大小与预期不一致(被轮转或其他进程写入),结束当前的索引块并写出索引项。
+     * 其他写入者追加的内容并入这个块,级别未知按所有级别记录,保证查询时不会跳过这段内容
+     */
     bool FileLogAppender::reopen()
     {
         if (filestream_.is_open())
         {
             filestream_.close();
         }
-        filestream_.open(filename_);
+        filestream_.open(filename_, std::ios::app);
+        struct stat st;
+        uint64_t size = stat(filename_.c_str(), &st) == 0 ? st.st_size : 0;
+        if (size != offset_)
+        {
+            if (indexInterval_ && size > offset_)
+            {
+                if (!blockOpen_)
+                {
+                    block_.begin_time = lastTime_;
+                    block_.offset = offset_;
+                    block_.length = 0;
+                    block_.levels = 0;
+                    blockOpen_ = true;
+                }
+                block_.end_time = time(0);
+                block_.length += size - offset_;
+                block_.levels = ~0u;
+            }
+            close_block();
+            if (indexInterval_ && size < offset_)
+            {
+                //日志文件被轮转,旧的索引已经没有意义
+                indexstream_.close();
+                indexstream_.open(LogIndex::index_path(filename_), std::ios::binary | std::ios::trunc);
+            }
+            offset_ = size;
+        }
         return filestream_.is_open();
     }
 
+    void FileLogAppender::set_index(uint32_t interval_kb)
+    {
+        MutexType::Lock lock(mutex_);
+        close_block();
+        indexInterval_ = interval_kb;
+        if (indexstream_.is_open())
+        {
+            indexstream_.close();
+        }
+        if (indexInterval_)
+        {
+            indexstream_.open(LogIndex::index_path(filename_), std::ios::binary | std::ios::app);
+        }
+    }
+
+    //先把日志刷到文件,再写索引项,保证索引不会指向还没有落盘的内容
+    void FileLogAppender::close_block()
+    {
+        if (!blockOpen_)
+        {
+            return;
+        }
+        blockOpen_ = false;
+        filestream_.flush();
+        if (indexstream_.is_open())
+        {
+            indexstream_.write((const char *)&block_, sizeof(block_));
+            indexstream_.flush();
+        }
+    }
+
+    AsyncLogAppender::AsyncLogAppender(LogAppender::Ptr appender, size_t max_queue)
+        : appender_(appender), max_queue_(max_queue)
+    {
+        level_ = appender_->get_level();
+        formatter_ = appender_->get_formatter();
+        hasFormatter_ = appender_->hasFormatter_;
+        thread_.reset(new Thread(std::bind(&AsyncLogAppender::run, this), "log_async"));
+    }
+
+    AsyncLogAppender::~AsyncLogAppender()
+    {
+        stopping_ = true;
+        semaphore_.post();
+        thread_->join();
+    }
+
+    std::string AsyncLogAppender::toYamlString()
+    {
+        YAML::Node node = YAML::Load(appender_->toYamlString());
+        MutexType::Lock lock(mutex_);
+        node["async"] = true;
+        if (level_ != LogLevel::UNKNOW)
+        {
+            node["level"] = LogLevel::to_string(level_);
+        }
+        if (formatter_)
+        {
+            node["formatter"] = formatter_->get_pattern();
+        }
+        if (filter_)
+        {
+            node["filter"] = filter_->get_expr();
+        }
+        std::stringstream ss;
+        ss << node;
+        return ss.str();
+    }
+
+    LogMetricsSnapshot AsyncLogAppender::get_metrics() const
+    {
+        LogMetricsSnapshot snap = LogAppender::get_metrics();
+        snap.appenders.push_back(appender_->get_metrics());
+        return snap;
+    }
+
+    bool AsyncLogAppender::write(LogLevel::Level level, const std::string &content)
+    {
+        {
+            MutexType::Lock lock(queue_mutex_);
+            if (queue_.size() >= max_queue_)
+            {
+                metrics_.add_dropped();
+                return false;
+            }
+            queue_.push_back(std::make_pair(level, content));
+        }
+        semaphore_.post();
+        return true;
+    }
+
+    //后台线程:每次唤醒取走队列中所有内容,依次交给被包装的appender输出
+    void AsyncLogAppender::run()
+    {
+        std::deque<std::pair<LogLevel::Level, std::string>> items;
+        while (true)
+        {
+            semaphore_.wait();
+            {
+                MutexType::Lock lock(queue_mutex_);
+                items.swap(queue_);
+            }
+            for (auto &item : items)
+            {
+                appender_->log_formatted(item.first, item.second);
+            }
+            items.clear();
+            if (stopping_)
+            {
+                MutexType::Lock lock(queue_mutex_);
+                if (queue_.empty())
+                {
+                    break;
+                }
+            }
+        }
+    }
+
     /*----------------Appender End---------------*/
 
     /*----------------Formatter------------------*/
@@ -4,11 +4,16 @@
 #include "singleton.h"
 #include "util.h"
 #include "locker.h"
+#include "thread.h"
+#include "log_metrics.h"
+#include "log_index.h"
+#include "log_filter.h"
 #include <string>
 #include <iostream>
 #include <memory>
 #include <vector>
 #include <list>
+#include <deque>
 #include <map>
 #include <functional>
 #include <fstream>
@@ -16,12 +21,19 @@
 #include <stdint.h>
 #include <stdarg.h>
 
+/* 日志器和日志输出地使用的锁类型,编译时选择(cmake -DBLUESKY_LOG_MUTEX=AdaptiveMutex)
+ * 可选Mutex(默认)、AdaptiveMutex、Spinlock、CASLock,见locker.h;
+ * 输出地的锁在写文件时持有,不建议使用纯自旋锁
+ */
+#ifndef BLUESKY_LOG_MUTEX
+#define BLUESKY_LOG_MUTEX Mutex
+#endif
 
 
 /*----------------------流式日志------------------*/
-//使用logger写入日志级别为level的日志
+//使用logger写入日志级别为level的日志,级别和过滤表达式在构造LogEvent和拼接日志内容之前判断
 #define BLUESKY_LOG_LEVEL(logger, level)                                                                              \
-    if (logger->get_level() <= level)                                                                                 \
+    if (logger->get_level() <= level && logger->accept(level, __FILE__, __LINE__))                                    \
     bluesky::LogEventWrap(logger, std::shared_ptr<bluesky::LogEvent>(new bluesky::LogEvent(logger->get_name(), level, \
                                                                                            __FILE__,                  \
                                                                                            __LINE__, 0,               \
@@ -43,7 +55,7 @@
 
 /*-----------------格式化 printf日志-----------------*/
 #define BLUESKY_LOG_FMT_LEVEL(logger, level, fmt, ...)                                                                \
-    if (logger->get_level() <= level)                                                                                 \
+    if (logger->get_level() <= level && logger->accept(level, __FILE__, __LINE__))                                    \
     bluesky::LogEventWrap(logger, std::shared_ptr<bluesky::LogEvent>(new bluesky::LogEvent(logger->get_name(), level, \
                                                                                            __FILE__,                  \
                                                                                            __LINE__, 0,               \
@@ -102,7 +114,7 @@ namespace bluesky
     {
     public:
         typedef std::shared_ptr<LoggerManager> Ptr;
-        typedef Mutex MutexType;
+        typedef RWMutex MutexType;
 
         LoggerManager();
         std::shared_ptr<Logger> get_logger(const std::string &name);
@@ -110,6 +122,8 @@ namespace bluesky
         void init();
         std::shared_ptr<Logger> get_root() const { return root_; }
         std::string toYamlString();
+        //所有日志器(含其appender)的统计数据快照
+        std::vector<LogMetricsSnapshot> get_metrics();
 
     private:
         std::map<std::string, std::shared_ptr<Logger>> loggers_;
@@ -133,15 +147,15 @@ namespace bluesky
                  uint32_t fiberID,
                  uint64_t time);
 
-        const std::string get_filename() const { return filename_; }
+        const std::string &get_filename() const { return filename_; }
         const int32_t get_line() const { return line_; }
         const uint32_t get_threadID() const { return threadID_; }
         const uint32_t get_fiberID() const { return fiberID_; }
         const uint64_t get_time() const { return time_; }
         const uint64_t get_elapse() const { return elapse_; }
-        const std::string get_threadname() const { return thread_name_; }
+        const std::string &get_threadname() const { return thread_name_; }
         const std::string get_content() const { return ss_.str(); }
-        const std::string get_loggername() const { return logger_name_; }
+        const std::string &get_loggername() const { return logger_name_; }
         //std::shared_ptr<Logger> get_logger() const { return logger_; }
         LogLevel::Level get_loglevel() const { return level_; }
         std::stringstream &get_ss() { return ss_; }
@@ -186,12 +200,14 @@ namespace bluesky
 
     public:
         typedef std::shared_ptr<Logger> Ptr;
-        typedef Mutex MutexType;
+        typedef BLUESKY_LOG_MUTEX MutexType;
 
         Logger(const std::string &name = "root", LogLevel::Level level = LogLevel::DEBUG);
 
-        //写入日志，指定日志的级别
+        //写入日志，指定日志的级别;过滤表达式已经由调用方(日志宏)通过accept判断过
         void log(LogLevel::Level level, const LogEvent::Ptr event);
+        //日志宏在构造LogEvent之前调用:只使用元数据对过滤表达式求值,不加锁,被过滤时计入suppressed
+        bool accept(LogLevel::Level level, const char *file, int32_t line);
 
         //日志级别输出
         void debug(std::shared_ptr<LogEvent> event);
@@ -204,17 +220,29 @@ namespace bluesky
         void add_appender(std::shared_ptr<LogAppender> appender);
         void del_appender(std::shared_ptr<LogAppender> appender);
         void clear_appender();
+        //整体替换appender列表,没有格式的appender使用日志器的格式
+        void set_appenders(const std::list<std::shared_ptr<LogAppender>> &appenders);
 
         const std::string &get_name() const { return name_; }
         const LogLevel::Level get_level() const { return level_; }
         void set_level(LogLevel::Level level) { level_ = level; }
 
+        //多个appender使用相同格式时,每条日志只格式化一次,格式化结果在appender之间共享
+        bool is_shared_format() const { return shared_format_; }
+        void set_shared_format(bool value) { shared_format_ = value; }
+
+        //过滤表达式,由日志宏在级别判断之后、构造日志事件之前求值(见accept),nullptr表示不过滤
+        void set_filter(LogFilter::Ptr filter);
+        LogFilter::Ptr get_filter();
+
         //设置formatter
         void set_formatter(std::shared_ptr<LogFormatter> &formatter);
         void set_formatter(const std::string &value);
         std::shared_ptr<LogFormatter> get_formatter();
 
         std::string toYamlString();
+        //日志器及其appender的统计数据快照
+        LogMetricsSnapshot get_metrics();
 
     private:
         std::string name_;
@@ -222,6 +250,9 @@ namespace bluesky
         std::list<std::shared_ptr<LogAppender>> appenders_;
         std::shared_ptr<LogFormatter> formatter_;
         Logger::Ptr root_;
+        bool shared_format_ = true;
+        LogFilter::Ptr filter_; //使用std::atomic_load/atomic_store读写,accept读取时不加锁
+        LogMetrics metrics_;
         MutexType mutex_;
     };
 
@@ -265,7 +296,7 @@ namespace bluesky
 
         void init();
         bool is_error() const { return error_; }
-        std::string get_pattern() { return pattern_; }
+        const std::string &get_pattern() const { return pattern_; }
 
     private:
         std::string pattern_;                //日志格式
@@ -278,22 +309,36 @@ namespace bluesky
     {
     public:
         typedef std::shared_ptr<LogAppender> Ptr;
-        typedef Mutex MutexType;
+        typedef BLUESKY_LOG_MUTEX MutexType;
         virtual ~LogAppender() {}
 
-        virtual void log(std::shared_ptr<Logger> logger, LogLevel::Level level, std::shared_ptr<LogEvent> event) = 0;
+        //格式化日志事件并输出,返回是否写入(被过滤或者丢弃时返回false)
+        virtual bool log(std::shared_ptr<Logger> logger, LogLevel::Level level, std::shared_ptr<LogEvent> event);
+        //输出已经格式化好的日志内容,只有写入成功的日志计入lines/bytes和耗时
+        bool log_formatted(LogLevel::Level level, const std::string &content);
+        //将格式化好的日志内容写入输出地,队列已满等原因丢弃时计入dropped并返回false
+        virtual bool write(LogLevel::Level level, const std::string &content) = 0;
         virtual std::string toYamlString() = 0;
+        //输出地名称,用于统计数据
+        virtual std::string get_name() const = 0;
 
     public:
         void set_formatter(std::shared_ptr<LogFormatter> formatter);
         std::shared_ptr<LogFormatter> get_formatter();
         LogLevel::Level get_level() const { return level_; }
         void set_level(LogLevel::Level level) { level_ = level; }
+        void set_filter(LogFilter::Ptr filter);
+        LogFilter::Ptr get_filter();
+        //级别和过滤表达式都满足时返回true,否则计入suppressed
+        bool accept(LogLevel::Level level, const LogEvent &event);
+        virtual LogMetricsSnapshot get_metrics() const;
 
     public:
-        LogLevel::Level level_;
+        LogLevel::Level level_ = LogLevel::UNKNOW;
         std::shared_ptr<LogFormatter> formatter_;
+        LogFilter::Ptr filter_;
         bool hasFormatter_ = false;
+        LogMetrics metrics_;
         MutexType mutex_;
     };
 
@@ -302,8 +347,9 @@ namespace bluesky
     {
     public:
         typedef std::shared_ptr<StdoutLogAppender> Ptr;
-        virtual void log(std::shared_ptr<Logger> logger, LogLevel::Level level, std::shared_ptr<LogEvent> event) override;
+        virtual bool write(LogLevel::Level level, const std::string &content) override;
         virtual std::string toYamlString();
+        virtual std::string get_name() const override { return "stdout"; }
     };
 
     //输出到文件
@@ -313,16 +359,63 @@ namespace bluesky
         typedef std::shared_ptr<FileLogAppender> Ptr;
 
         FileLogAppender(const std::string &filename);
+        ~FileLogAppender();
         virtual std::string toYamlString();
-        virtual void log(std::shared_ptr<Logger> logger, LogLevel::Level level, std::shared_ptr<LogEvent> event) override;
+        virtual bool write(LogLevel::Level level, const std::string &content) override;
+        virtual std::string get_name() const override { return filename_; }
 
         //重新打开文件
         bool reopen();
 
+        //开启稀疏索引:每写满interval_kb KB日志,在<filename>.idx中追加一条索引项,0表示关闭
+        void set_index(uint32_t interval_kb);
+        uint32_t get_index() const { return indexInterval_; }
+
+    private:
+        void close_block();
+
     private:
         std::string filename_;
         std::ofstream filestream_;
         uint64_t lastTime_=0;
+        uint64_t offset_ = 0;           //当前文件大小,即下一条日志的偏移
+        uint32_t indexInterval_ = 0;    //索引间隔(KB)
+        bool blockOpen_ = false;
+        LogIndexEntry block_;           //正在写入的块
+        std::ofstream indexstream_;
+    };
+
+    //异步输出:在调用线程完成格式化,格式化好的内容通过有界队列交给后台线程,
+    //由后台线程写入被包装的appender,用于包装较慢的输出地
+    class AsyncLogAppender : public LogAppender
+    {
+    public:
+        typedef std::shared_ptr<AsyncLogAppender> Ptr;
+
+        AsyncLogAppender(LogAppender::Ptr appender, size_t max_queue = 8192);
+        ~AsyncLogAppender();
+
+        virtual std::string toYamlString();
+        virtual bool write(LogLevel::Level level, const std::string &content) override;
+        virtual std::string get_name() const override { return "async:" + appender_->get_name(); }
+        //统计数据中包含被包装appender的实际写入情况
+        virtual LogMetricsSnapshot get_metrics() const override;
+
+        LogAppender::Ptr get_appender() const { return appender_; }
+        //队列已满而被丢弃的日志条数
+        uint64_t get_dropped() const { return metrics_.get_dropped(); }
+
+    private:
+        void run();
+
+    private:
+        LogAppender::Ptr appender_;
+        size_t max_queue_;
+        std::deque<std::pair<LogLevel::Level, std::string>> queue_;
+        MutexType queue_mutex_;
+        Semaphore semaphore_;
+        std::atomic<bool> stopping_{false};
+        Thread::Ptr thread_;
     };
 
     
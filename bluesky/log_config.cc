@@ -3,13 +3,13 @@
 namespace bluesky
 {
 
+    //日志配置直接从YAML节点解析,字符串转换使用config.h中容器的通用实现
     template <>
-    class LexicalCast<std::string, std::set<LogDefine>>
+    class FromNode<std::set<LogDefine>>
     {
     public:
-        std::set<LogDefine> operator()(const std::string &v)
+        std::set<LogDefine> operator()(const YAML::Node &node)
         {
-            YAML::Node node = YAML::Load(v);
             std::set<LogDefine> st;
             for (auto i = 0; i < node.size(); i++)
             {
@@ -38,6 +38,10 @@ namespace bluesky
 
                     lgd.formatter = n["formatter"].as<std::string>();
                 }
+                if (n["filter"].IsDefined())
+                {
+                    lgd.filter = n["filter"].as<std::string>();
+                }
                 if (n["appenders"].IsDefined())
                 {
                     std::cout << std::endl
@@ -62,6 +66,10 @@ namespace bluesky
                                 continue;
                             }
                             new_app.file = app["file"].as<std::string>();
+                            if (app["index_interval"].IsDefined())
+                            {
+                                new_app.index_interval = app["index_interval"].as<uint32_t>();
+                            }
                             if (app["formatter"].IsDefined())
                             {
                                 new_app.formatter = app["formatter"].as<std::string>();
@@ -76,12 +84,39 @@ namespace bluesky
                                 new_app.formatter = app["formatter"].as<std::string>();
                             }
                         }
+                        else if (type == "SocketLogAppender")
+                        {
+                            new_app.type = 3;
+                            if (!app["address"].IsDefined())
+                            {
+                                std::cout << "log config error: socketappender address is null" << app << std::endl;
+                                continue;
+                            }
+                            new_app.address = app["address"].as<std::string>();
+                            if (app["formatter"].IsDefined())
+                            {
+                                new_app.formatter = app["formatter"].as<std::string>();
+                            }
+                        }
                         else
                         {
 
                             std::cout << "log config error: appender type error" << std::endl;
                             continue;
                         }
+                        if (app["async"].IsDefined())
+                        {
+                            new_app.async = app["async"].as<bool>();
+                        }
+                        if (app["filter"].IsDefined())
+                        {
+                            new_app.filter = app["filter"].as<std::string>();
+                        }
+                        if (app["level"].IsDefined())
+                        {
+                            std::string level = app["level"].as<std::string>();
+                            new_app.level = LogLevel::from_string(level);
+                        }
                         lgd.appenders.push_back(new_app);
                     }
                 }
@@ -92,13 +127,12 @@ namespace bluesky
         }
     };
     template <>
-    class LexicalCast<std::set<LogDefine>, std::string>
+    class ToNode<std::set<LogDefine>>
     {
     public:
-        std::string operator()(const std::set<LogDefine> &v)
+        YAML::Node operator()(const std::set<LogDefine> &v)
         {
-            YAML::Node node;
-            std::stringstream ss;
+            YAML::Node node(YAML::NodeType::Sequence);
             for (auto &lgd : v)
             {
                 YAML::Node n;
@@ -112,6 +146,10 @@ namespace bluesky
                 {
                     n["formatter"] = lgd.formatter;
                 }
+                if (!lgd.filter.empty())
+                {
+                    n["filter"] = lgd.filter;
+                }
                 if (!lgd.appenders.empty())
                 {
 
@@ -122,6 +160,10 @@ namespace bluesky
                         {
                             app_node["type"] = "FileLogAppender";
                             app_node["file"] = app.file;
+                            if (app.index_interval)
+                            {
+                                app_node["index_interval"] = app.index_interval;
+                            }
                             /*
                             if (!app.file.empty())
                             {
@@ -140,6 +182,11 @@ namespace bluesky
 
                             app_node["type"] = "StdoutLogAppender";
                         }
+                        else if (app.type == 3)
+                        {
+                            app_node["type"] = "SocketLogAppender";
+                            app_node["address"] = app.address;
+                        }
                         if (app.level != LogLevel::UNKNOW)
                         {
                             app_node["level"] = LogLevel::to_string(app.level);
@@ -148,18 +195,180 @@ namespace bluesky
                         {
                             app_node["formatter"] = app.formatter;
                         }
+                        if (app.async)
+                        {
+                            app_node["async"] = true;
+                        }
+                        if (!app.filter.empty())
+                        {
+                            app_node["filter"] = app.filter;
+                        }
                         n["appenders"].push_back(app_node);
                     }
                 }
                 node.push_back(n);
             }
-            ss << node;
-            return ss.str();
+            return node;
         }
     };
 
-    std::shared_ptr<bluesky::ConfigVar<std::set<bluesky::LogDefine>>> g_log_defines =
-        bluesky::Config::lookup("logs", std::set<bluesky::LogDefine>(), "logs default config");
+    //编译过滤表达式,表达式为空或者有语法错误时返回nullptr(不过滤)
+    static LogFilter::Ptr compile_filter(const std::string &name, const std::string &expr)
+    {
+        if (expr.empty())
+        {
+            return nullptr;
+        }
+        std::string error;
+        LogFilter::Ptr filter = LogFilter::compile(expr, &error);
+        if (!filter)
+        {
+            std::cout << "log.name = " << name << "  filter = " << expr
+                      << "  is invalid: " << error << std::endl;
+        }
+        return filter;
+    }
+
+    //输出地本身(类型/文件/地址/索引/异步)相同时复用已有的appender,级别、格式和过滤条件原地修改
+    static bool same_target(const LogAppenderDefine &a, const LogAppenderDefine &b)
+    {
+        return a.type == b.type && a.file == b.file && a.address == b.address &&
+               a.index_interval == b.index_interval && a.async == b.async;
+    }
+
+    //按配置创建appender,级别、格式和过滤条件由configure_appender设置
+    static LogAppender::Ptr create_appender(const LogAppenderDefine &app)
+    {
+        LogAppender::Ptr new_app;
+        if (app.type == 1)
+        {
+            FileLogAppender::Ptr file_app(new FileLogAppender(app.file));
+            if (app.index_interval)
+            {
+                file_app->set_index(app.index_interval);
+            }
+            new_app = file_app;
+        }
+        else if (app.type == 2)
+        {
+            new_app.reset(new StdoutLogAppender);
+        }
+        else if (app.type == 3)
+        {
+            new_app.reset(new SocketLogAppender(app.address));
+        }
+        else
+        {
+            return nullptr;
+        }
+        if (app.async)
+        {
+            new_app.reset(new AsyncLogAppender(new_app));
+        }
+        return new_app;
+    }
+
+    /* 设置appender的级别、格式和过滤条件,只重新编译有变化的部分
+     * prev: 复用的appender之前的配置,新建的appender为nullptr
+     * logger_formatter_changed: 日志器的格式变化时会覆盖所有appender的格式,需要重新设置
+     */
+    static void configure_appender(Logger::Ptr logger, LogAppender::Ptr appender, const LogAppenderDefine &app,
+                                   const LogAppenderDefine *prev, bool logger_formatter_changed)
+    {
+        appender->set_level(app.level);
+        if (!prev || prev->formatter != app.formatter || logger_formatter_changed)
+        {
+            LogFormatter::Ptr fmt;
+            if (!app.formatter.empty())
+            {
+                fmt.reset(new LogFormatter(app.formatter));
+                if (fmt->is_error())
+                {
+                    std::cout << "log.name = " << logger->get_name() << "  appender type = " << app.type
+                              << "  formatter = " << app.formatter << "  is invalid" << std::endl;
+                    fmt.reset();
+                }
+            }
+            appender->set_formatter(fmt ? fmt : logger->get_formatter());
+        }
+        if (!prev || prev->filter != app.filter)
+        {
+            //过滤放在异步队列之前,被过滤的日志不会入队
+            appender->set_filter(compile_filter(logger->get_name(), app.filter));
+        }
+    }
+
+    //每个日志器当前由配置创建的appender及其配置
+    typedef std::vector<std::pair<LogAppenderDefine, LogAppender::Ptr>> AppenderList;
+
+    static std::map<std::string, AppenderList> &get_config_appenders()
+    {
+        static std::map<std::string, AppenderList> appenders;
+        return appenders;
+    }
+
+    static Mutex &get_config_appenders_mutex()
+    {
+        static Mutex mutex;
+        return mutex;
+    }
+
+    /* 按配置增量更新日志器
+     * old为之前的配置(新增的日志器为nullptr),只修改有变化的部分;
+     * 输出地不变的appender和它打开的文件会被保留,新的appender列表构造好之后在日志器的锁内一次替换
+     */
+    static void update_logger(const LogDefine &define, const LogDefine *old)
+    {
+        Logger::Ptr logger = BLUESKY_LOG_NAME(define.name);
+        logger->set_level(define.level);
+        bool formatter_changed = !old || old->formatter != define.formatter;
+        if (formatter_changed && !define.formatter.empty())
+        {
+            logger->set_formatter(define.formatter);
+        }
+        if (!old || old->filter != define.filter)
+        {
+            logger->set_filter(compile_filter(define.name, define.filter));
+        }
+
+        Mutex::Lock lock(get_config_appenders_mutex());
+        AppenderList &current = get_config_appenders()[define.name];
+        std::vector<bool> reused(current.size(), false);
+        AppenderList next;
+        std::list<LogAppender::Ptr> appenders;
+        for (auto &app : define.appenders)
+        {
+            LogAppender::Ptr appender;
+            const LogAppenderDefine *prev = nullptr;
+            for (size_t i = 0; i < current.size(); i++)
+            {
+                if (!reused[i] && same_target(current[i].first, app))
+                {
+                    reused[i] = true;
+                    appender = current[i].second;
+                    prev = &current[i].first;
+                    break;
+                }
+            }
+            if (!appender)
+            {
+                appender = create_appender(app);
+                if (!appender)
+                {
+                    continue;
+                }
+            }
+            configure_appender(logger, appender, app, prev, formatter_changed);
+            next.push_back(std::make_pair(app, appender));
+            appenders.push_back(appender);
+        }
+        logger->set_appenders(appenders);
+        //没有被复用的appender在这里释放(文件关闭、异步队列写完)
+        current.swap(next);
+    }
+
+    static bluesky::ConfigStatic<std::set<bluesky::LogDefine>> g_log_defines("logs", std::set<bluesky::LogDefine>(),
+                                                                              "logs default config");
 
     LogIniter::LogIniter()
     {
@@ -170,50 +379,13 @@ namespace bluesky
                                         for (auto &i : new_value)
                                         {
                                             auto iter = old_value.find(i);
-                                            std::shared_ptr<Logger> logger = BLUESKY_LOG_NAME(i.name);
-                                            /*
                                             if (iter == old_value.end())
                                             {
-                                                logger = BLUESKY_LOG_NAME(i.name);
-                                            }
-                                            else
-                                            {
-                                                if (!(i == *iter))
-                                                {
-                                                    logger = BLUESKY_LOG_NAME(i.name);
-                                                }
-                                            }
-                                            */
-
-                                            logger->set_level(i.level);
-                                            if (!i.formatter.empty())
-                                            {
-                                                logger->set_formatter(i.formatter);
+                                                update_logger(i, nullptr);
                                             }
-                                            logger->clear_appender();
-                                            for (auto &app : i.appenders)
+                                            else if (!(i == *iter))
                                             {
-                                                std::shared_ptr<LogAppender> new_app;
-                                                if (app.type == 1)
-                                                {
-                                                    new_app.reset(new FileLogAppender(app.file));
-                                                }
-                                                else if (app.type == 2)
-                                                {
-                                                    new_app.reset(new StdoutLogAppender);
-                                                }
-                                                new_app->set_level(app.level);
-                                                if(!app.formatter.empty()){
-                                                    LogFormatter::Ptr fmt(new LogFormatter(app.formatter));
-                                                    if(!fmt->is_error())
-                                                    {
-                                                        new_app->set_formatter(fmt);
-                                                    }else{
-                                                        std::cout << "log.name = " << i.name << "  appender type = " << app.type
-                                                                  << "  formatter = " << app.formatter << "  is invalid" << std::endl;
-                                                    }
-                                                }
-                                                logger->add_appender(new_app);
+                                                update_logger(i, &*iter);
                                             }
                                         }
                                         for (auto &i : old_value)
@@ -223,7 +395,10 @@ namespace bluesky
                                             {
                                                 auto logger = BLUESKY_LOG_NAME(i.name);
                                                 logger->set_level(LogLevel::UNKNOW);
+                                                logger->set_filter(nullptr);
                                                 logger->clear_appender();
+                                                Mutex::Lock lock(get_config_appenders_mutex());
+                                                get_config_appenders().erase(i.name);
                                             }
                                         }
                                     });
@@ -3,19 +3,24 @@
 
 #include "log.h"
 #include "config.h"
+#include "log_socket.h"
 
 namespace bluesky
 {
     struct LogAppenderDefine
     {
-        int type = 0; //1 FILE, 2 STDOUT
+        int type = 0; //1 FILE, 2 STDOUT, 3 SOCKET
         LogLevel::Level level = LogLevel::UNKNOW;
         std::string formatter;
         std::string file;
+        std::string address; //SocketLogAppender的目标地址
+        uint32_t index_interval = 0; //FileLogAppender的索引间隔(KB),0表示不建索引
+        bool async = false; //是否通过后台线程异步输出
+        std::string filter; //过滤表达式,见LogFilter
 
         bool operator==(const LogAppenderDefine &appender) const
         {
-            return type == appender.type && level == appender.level && formatter == appender.formatter && file == appender.file;
+            return type == appender.type && level == appender.level && formatter == appender.formatter && file == appender.file && address == appender.address && index_interval == appender.index_interval && async == appender.async && filter == appender.filter;
         }
     };
 
@@ -26,11 +31,12 @@ namespace bluesky
         std::string name;
         LogLevel::Level level = LogLevel::UNKNOW;
         std::string formatter;
+        std::string filter;
         std::vector<LogAppenderDefine> appenders;
 
         bool operator==(const LogDefine &lgd) const
         {
-            return name == lgd.name && level == lgd.level && formatter == lgd.formatter && appenders == lgd.appenders;
+            return name == lgd.name && level == lgd.level && formatter == lgd.formatter && filter == lgd.filter && appenders == lgd.appenders;
         }
         bool operator<(const LogDefine &lgd) const
         {
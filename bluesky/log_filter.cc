@@ -0,0 +1,407 @@
+#include "log_filter.h"
+#include "log.h"
+#include <fnmatch.h>
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+namespace bluesky
+{
+    /* 递归下降解析器,把表达式编译到LogFilter::nodes_中 */
+    class LogFilterParser
+    {
+    public:
+        LogFilterParser(const std::string &expr, LogFilter &filter)
+            : expr_(expr), filter_(filter)
+        {
+        }
+
+        bool parse(std::string &error)
+        {
+            next();
+            int root = parse_or();
+            if (root >= 0 && token_ != END)
+            {
+                fail("unexpected '" + text_ + "'");
+            }
+            if (!error_.empty())
+            {
+                error = error_;
+                return false;
+            }
+            filter_.root_ = root;
+            return true;
+        }
+
+    private:
+        enum Token
+        {
+            END,
+            IDENT,
+            NUMBER,
+            STRING,
+            OPERATOR,
+            LPAREN,
+            RPAREN
+        };
+
+        void fail(const std::string &msg)
+        {
+            if (error_.empty())
+            {
+                error_ = msg + " at " + std::to_string(start_) + " in: " + expr_;
+            }
+        }
+
+        //读取下一个token
+        void next()
+        {
+            while (pos_ < expr_.size() && isspace((unsigned char)expr_[pos_]))
+            {
+                ++pos_;
+            }
+            start_ = pos_;
+            text_.clear();
+            if (pos_ >= expr_.size())
+            {
+                token_ = END;
+                return;
+            }
+            char c = expr_[pos_];
+            if (c == '(' || c == ')')
+            {
+                token_ = c == '(' ? LPAREN : RPAREN;
+                text_ = c;
+                ++pos_;
+            }
+            else if (c == '"' || c == '\'')
+            {
+                size_t end = expr_.find(c, pos_ + 1);
+                if (end == std::string::npos)
+                {
+                    fail("unterminated string");
+                    token_ = END;
+                    return;
+                }
+                token_ = STRING;
+                text_ = expr_.substr(pos_ + 1, end - pos_ - 1);
+                pos_ = end + 1;
+            }
+            else if (isdigit((unsigned char)c) || (c == '-' && pos_ + 1 < expr_.size() && isdigit((unsigned char)expr_[pos_ + 1])))
+            {
+                size_t end = pos_ + 1;
+                while (end < expr_.size() && isdigit((unsigned char)expr_[end]))
+                {
+                    ++end;
+                }
+                token_ = NUMBER;
+                text_ = expr_.substr(pos_, end - pos_);
+                pos_ = end;
+            }
+            else if (isalpha((unsigned char)c) || c == '_' || c == '.' || c == '*')
+            {
+                size_t end = pos_;
+                while (end < expr_.size() && (isalnum((unsigned char)expr_[end]) || strchr("_.*?/-", expr_[end])))
+                {
+                    ++end;
+                }
+                token_ = IDENT;
+                text_ = expr_.substr(pos_, end - pos_);
+                pos_ = end;
+            }
+            else
+            {
+                static const char *ops[] = {"&&", "||", "==", "!=", "<=", ">=", "<", ">", "!", "~"};
+                for (auto op : ops)
+                {
+                    if (expr_.compare(pos_, strlen(op), op) == 0)
+                    {
+                        token_ = OPERATOR;
+                        text_ = op;
+                        pos_ += strlen(op);
+                        return;
+                    }
+                }
+                fail(std::string("unexpected character '") + c + "'");
+                token_ = END;
+            }
+        }
+
+        bool accept(const char *op, const char *word)
+        {
+            if ((token_ == OPERATOR && text_ == op) || (token_ == IDENT && text_ == word))
+            {
+                next();
+                return true;
+            }
+            return false;
+        }
+
+        int add(const LogFilter::Node &node)
+        {
+            filter_.nodes_.push_back(node);
+            return filter_.nodes_.size() - 1;
+        }
+
+        int binary(LogFilter::Op op, int left, int right)
+        {
+            LogFilter::Node node;
+            node.op = op;
+            node.left = left;
+            node.right = right;
+            return add(node);
+        }
+
+        int parse_or()
+        {
+            int left = parse_and();
+            while (error_.empty() && accept("||", "or"))
+            {
+                left = binary(LogFilter::OR, left, parse_and());
+            }
+            return left;
+        }
+
+        int parse_and()
+        {
+            int left = parse_unary();
+            while (error_.empty() && accept("&&", "and"))
+            {
+                left = binary(LogFilter::AND, left, parse_unary());
+            }
+            return left;
+        }
+
+        int parse_unary()
+        {
+            if (accept("!", "not"))
+            {
+                return binary(LogFilter::NOT, parse_unary(), -1);
+            }
+            if (token_ == LPAREN)
+            {
+                next();
+                int idx = parse_or();
+                if (token_ != RPAREN)
+                {
+                    fail("expect ')'");
+                    return -1;
+                }
+                next();
+                return idx;
+            }
+            return parse_compare();
+        }
+
+        int parse_compare()
+        {
+            static const std::pair<const char *, LogFilter::Field> fields[] = {
+                {"level", LogFilter::LEVEL},
+                {"logger", LogFilter::LOGGER},
+                {"file", LogFilter::FILE},
+                {"line", LogFilter::LINE},
+                {"thread", LogFilter::THREAD},
+                {"fiber", LogFilter::FIBER},
+            };
+            static const std::pair<const char *, LogFilter::Op> ops[] = {
+                {"==", LogFilter::EQ},
+                {"!=", LogFilter::NE},
+                {"<", LogFilter::LT},
+                {"<=", LogFilter::LE},
+                {">", LogFilter::GT},
+                {">=", LogFilter::GE},
+                {"~", LogFilter::GLOB},
+            };
+
+            LogFilter::Node node;
+            bool found = false;
+            for (auto &f : fields)
+            {
+                if (token_ == IDENT && text_ == f.first)
+                {
+                    node.field = f.second;
+                    found = true;
+                }
+            }
+            if (!found)
+            {
+                fail("unknown field '" + text_ + "'");
+                return -1;
+            }
+            next();
+            found = false;
+            for (auto &o : ops)
+            {
+                if (token_ == OPERATOR && text_ == o.first)
+                {
+                    node.op = o.second;
+                    found = true;
+                }
+            }
+            if (!found)
+            {
+                fail("expect compare operator");
+                return -1;
+            }
+            next();
+            if (token_ != IDENT && token_ != NUMBER && token_ != STRING)
+            {
+                fail("expect value");
+                return -1;
+            }
+
+            bool is_string = node.field == LogFilter::LOGGER || node.field == LogFilter::FILE;
+            if (is_string)
+            {
+                if (node.op != LogFilter::EQ && node.op != LogFilter::NE && node.op != LogFilter::GLOB)
+                {
+                    fail("string field only supports == != ~");
+                    return -1;
+                }
+                node.str = text_;
+            }
+            else if (node.op == LogFilter::GLOB)
+            {
+                fail("'~' only applies to logger and file");
+                return -1;
+            }
+            else if (node.field == LogFilter::LEVEL && token_ != NUMBER)
+            {
+                std::string name = text_;
+                std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+                node.number = -1;
+                for (int i = LogLevel::DEBUG; i <= LogLevel::FATAL; i++)
+                {
+                    if (name == LogLevel::to_string((LogLevel::Level)i))
+                    {
+                        node.number = i;
+                    }
+                }
+                if (node.number < 0)
+                {
+                    fail("unknown level '" + text_ + "'");
+                    return -1;
+                }
+            }
+            else if (token_ == NUMBER)
+            {
+                node.number = strtoll(text_.c_str(), nullptr, 10);
+            }
+            else
+            {
+                fail("expect number");
+                return -1;
+            }
+            next();
+            return add(node);
+        }
+
+    private:
+        const std::string &expr_;
+        LogFilter &filter_;
+        size_t pos_ = 0;
+        size_t start_ = 0;
+        Token token_ = END;
+        std::string text_;
+        std::string error_;
+    };
+
+    LogFilter::Ptr LogFilter::compile(const std::string &expr, std::string *error)
+    {
+        LogFilter::Ptr filter(new LogFilter);
+        filter->expr_ = expr;
+        LogFilterParser parser(filter->expr_, *filter);
+        std::string err;
+        if (!parser.parse(err))
+        {
+            if (error)
+            {
+                *error = err;
+            }
+            return nullptr;
+        }
+        return filter;
+    }
+
+    bool LogFilter::match(int level, const LogEvent &event) const
+    {
+        LogFilterFields fields = {event.get_loggername(), event.get_filename().c_str(), event.get_line(),
+                                  event.get_threadID(), event.get_fiberID()};
+        return match(level, fields);
+    }
+
+    bool LogFilter::match(int level, const LogFilterFields &fields) const
+    {
+        return root_ < 0 || eval(root_, level, fields);
+    }
+
+    bool LogFilter::eval(int idx, int level, const LogFilterFields &fields) const
+    {
+        const Node &node = nodes_[idx];
+        switch (node.op)
+        {
+        case AND:
+            return eval(node.left, level, fields) && eval(node.right, level, fields);
+        case OR:
+            return eval(node.left, level, fields) || eval(node.right, level, fields);
+        case NOT:
+            return !eval(node.left, level, fields);
+        default:
+            break;
+        }
+
+        if (node.field == LOGGER || node.field == FILE)
+        {
+            const char *value = node.field == LOGGER ? fields.logger.c_str() : fields.file;
+            switch (node.op)
+            {
+            case EQ:
+                return node.str == value;
+            case NE:
+                return node.str != value;
+            case GLOB:
+                return fnmatch(node.str.c_str(), value, 0) == 0;
+            default:
+                return false;
+            }
+        }
+
+        int64_t value = 0;
+        switch (node.field)
+        {
+        case LEVEL:
+            value = level;
+            break;
+        case LINE:
+            value = fields.line;
+            break;
+        case THREAD:
+            value = fields.threadID;
+            break;
+        case FIBER:
+            value = fields.fiberID;
+            break;
+        default:
+            break;
+        }
+        switch (node.op)
+        {
+        case EQ:
+            return value == node.number;
+        case NE:
+            return value != node.number;
+        case LT:
+            return value < node.number;
+        case LE:
+            return value <= node.number;
+        case GT:
+            return value > node.number;
+        case GE:
+            return value >= node.number;
+        default:
+            return false;
+        }
+    }
+
+} //end of namespace
@@ -0,0 +1,94 @@
+#ifndef __BLUESKY_LOG_FILTER_H__
+#define __BLUESKY_LOG_FILTER_H__
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+namespace bluesky
+{
+    class LogEvent;
+
+    //过滤表达式使用的元数据,日志宏在构造LogEvent之前用它判断是否输出
+    struct LogFilterFields
+    {
+        const std::string &logger;
+        const char *file;
+        int32_t line;
+        uint32_t threadID;
+        uint32_t fiberID;
+    };
+
+    /* 日志过滤表达式:编译一次成为谓词树,在格式化之前根据LogEvent的元数据判断是否输出
+     * 语法:
+     *      expr     := and_expr (("||" | "or") and_expr)*
+     *      and_expr := unary (("&&" | "and") unary)*
+     *      unary    := ("!" | "not") unary | "(" expr ")" | compare
+     *      compare  := field op value
+     *      field    := level | logger | file | line | thread | fiber
+     *      op       := == != < <= > >= ~       (~ 为通配符匹配,支持*和?)
+     *      value    := 标识符 | 数字 | "字符串" | '字符串'
+     * level的值可以是 debug/info/warn/error/fatal,字符串字段只支持 == != ~
+     * 例: level >= error || (level == debug && logger == "system.fiber" && file ~ "*fiber.cc")
+     */
+    class LogFilter
+    {
+    public:
+        typedef std::shared_ptr<LogFilter> Ptr;
+
+        //编译表达式,语法错误时返回nullptr,错误信息写入error
+        static Ptr compile(const std::string &expr, std::string *error = nullptr);
+
+        //level为本次输出使用的日志级别
+        bool match(int level, const LogEvent &event) const;
+        bool match(int level, const LogFilterFields &fields) const;
+        const std::string &get_expr() const { return expr_; }
+
+    public:
+        enum Field
+        {
+            LEVEL,
+            LOGGER,
+            FILE,
+            LINE,
+            THREAD,
+            FIBER
+        };
+        enum Op
+        {
+            AND,
+            OR,
+            NOT,
+            EQ,
+            NE,
+            LT,
+            LE,
+            GT,
+            GE,
+            GLOB
+        };
+        //谓词树节点,子节点用下标引用,整棵树存放在一个连续数组中
+        struct Node
+        {
+            Op op;
+            Field field;
+            int left = -1;
+            int right = -1;
+            int64_t number = 0;
+            std::string str;
+        };
+
+    private:
+        friend class LogFilterParser;
+        bool eval(int idx, int level, const LogFilterFields &fields) const;
+
+    private:
+        std::string expr_;
+        std::vector<Node> nodes_;
+        int root_ = -1;
+    };
+
+} //end of namespace
+
+#endif
@@ -0,0 +1,75 @@
+#include "log_index.h"
+#include <stdio.h>
+
+namespace bluesky
+{
+    static_assert(sizeof(LogIndexEntry) == 32, "LogIndexEntry must be 32 bytes on disk");
+
+    bool LogIndex::load(const std::string &index_file, std::vector<LogIndexEntry> &entries)
+    {
+        FILE *fp = fopen(index_file.c_str(), "rb");
+        if (!fp)
+        {
+            return false;
+        }
+        LogIndexEntry entry;
+        while (fread(&entry, sizeof(entry), 1, fp) == 1)
+        {
+            entries.push_back(entry);
+        }
+        fclose(fp);
+        return true;
+    }
+
+    std::vector<std::pair<uint64_t, uint64_t>> LogIndex::select(const std::vector<LogIndexEntry> &entries,
+                                                                uint64_t file_size,
+                                                                uint64_t begin_time,
+                                                                uint64_t end_time,
+                                                                uint32_t levels)
+    {
+        std::vector<std::pair<uint64_t, uint64_t>> ranges;
+        uint64_t indexed_end = 0;
+        for (auto &entry : entries)
+        {
+            if (entry.offset + entry.length > file_size)
+            {
+                //日志文件被截断或轮转,之后的索引项已经失效
+                break;
+            }
+            indexed_end = entry.offset + entry.length;
+            if (begin_time && entry.end_time < begin_time)
+            {
+                continue;
+            }
+            if (end_time && entry.begin_time > end_time)
+            {
+                continue;
+            }
+            if (levels && !(entry.levels & levels))
+            {
+                continue;
+            }
+            if (!ranges.empty() && ranges.back().second == entry.offset)
+            {
+                ranges.back().second += entry.length;
+            }
+            else
+            {
+                ranges.push_back(std::make_pair(entry.offset, entry.offset + entry.length));
+            }
+        }
+        if (indexed_end < file_size)
+        {
+            if (!ranges.empty() && ranges.back().second == indexed_end)
+            {
+                ranges.back().second = file_size;
+            }
+            else
+            {
+                ranges.push_back(std::make_pair(indexed_end, file_size));
+            }
+        }
+        return ranges;
+    }
+
+} //end of namespace
@@ -0,0 +1,48 @@
+#ifndef __BLUESKY_LOG_INDEX_H__
+#define __BLUESKY_LOG_INDEX_H__
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <utility>
+
+namespace bluesky
+{
+    /* 日志文件的稀疏索引
+     * FileLogAppender开启索引后,每写满interval KB的日志就在 <日志文件>.idx 中追加一条索引项,
+     * 记录这一块日志的时间范围、出现过的日志级别以及在日志文件中的偏移,
+     * 查询时根据索引只读取时间范围和级别都匹配的块
+     */
+    struct LogIndexEntry
+    {
+        uint64_t begin_time; //块内第一条日志的写入时间(秒)
+        uint64_t end_time;   //块内最后一条日志的写入时间(秒)
+        uint64_t offset;     //块在日志文件中的起始偏移
+        uint32_t length;     //块的字节数
+        uint32_t levels;     //块内出现过的日志级别位图(1 << LogLevel::Level)
+    };
+
+    class LogIndex
+    {
+    public:
+        //索引文件的路径
+        static std::string index_path(const std::string &log_file) { return log_file + ".idx"; }
+
+        //读取索引文件中的所有索引项
+        static bool load(const std::string &index_file, std::vector<LogIndexEntry> &entries);
+
+        /* 选出需要扫描的 [begin, end) 字节区间,相邻的区间会被合并
+         * begin_time/end_time: 查询的时间范围(秒,闭区间),0表示不限制
+         * levels: 日志级别位图,0表示不限制
+         * 最后一条索引项之后还没有建立索引的部分总是会被扫描,开启索引之前写入的部分不会被扫描
+         */
+        static std::vector<std::pair<uint64_t, uint64_t>> select(const std::vector<LogIndexEntry> &entries,
+                                                                 uint64_t file_size,
+                                                                 uint64_t begin_time,
+                                                                 uint64_t end_time,
+                                                                 uint32_t levels);
+    };
+
+} //end of namespace
+
+#endif
@@ -0,0 +1,168 @@
+#ifndef __BLUESKY_LOG_METRICS_H__
+#define __BLUESKY_LOG_METRICS_H__
+
+#include <stdint.h>
+#include <atomic>
+#include <string>
+#include <vector>
+
+namespace bluesky
+{
+    /* 耗时直方图(无锁)
+     * 第i个桶统计耗时落在 [2^i, 2^(i+1)) 纳秒内的次数,最后一个桶包含所有更大的值
+     */
+    class LatencyHistogram
+    {
+    public:
+        static const size_t BUCKETS = 40;
+
+        LatencyHistogram()
+        {
+            for (size_t i = 0; i < BUCKETS; i++)
+            {
+                buckets_[i] = 0;
+            }
+        }
+
+        void record(uint64_t ns)
+        {
+            size_t idx = 0;
+            while ((ns >> (idx + 1)) && idx + 1 < BUCKETS)
+            {
+                ++idx;
+            }
+            buckets_[idx].fetch_add(1, std::memory_order_relaxed);
+            count_.fetch_add(1, std::memory_order_relaxed);
+            sum_.fetch_add(ns, std::memory_order_relaxed);
+            uint64_t max = max_.load(std::memory_order_relaxed);
+            while (ns > max && !max_.compare_exchange_weak(max, ns, std::memory_order_relaxed))
+            {
+            }
+        }
+
+        void snapshot(std::vector<uint64_t> &buckets, uint64_t &count, uint64_t &sum, uint64_t &max) const
+        {
+            buckets.resize(BUCKETS);
+            for (size_t i = 0; i < BUCKETS; i++)
+            {
+                buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+            }
+            count = count_.load(std::memory_order_relaxed);
+            sum = sum_.load(std::memory_order_relaxed);
+            max = max_.load(std::memory_order_relaxed);
+        }
+
+    private:
+        std::atomic<uint64_t> buckets_[BUCKETS];
+        std::atomic<uint64_t> count_{0};
+        std::atomic<uint64_t> sum_{0};
+        std::atomic<uint64_t> max_{0};
+    };
+
+    //某一时刻的统计数据快照,用于定期采集
+    struct LogMetricsSnapshot
+    {
+        static const size_t LEVELS = 6;
+
+        std::string name;
+        uint64_t lines[LEVELS] = {0}; //按日志级别统计的输出行数
+        uint64_t bytes = 0;           //输出的字节数
+        uint64_t suppressed = 0;      //被级别过滤掉的行数
+        uint64_t dropped = 0;         //因队列已满等原因丢弃的行数
+        uint64_t latency_count = 0;
+        uint64_t latency_sum = 0;     //ns
+        uint64_t latency_max = 0;     //ns
+        std::vector<uint64_t> latency_buckets;
+        std::vector<LogMetricsSnapshot> appenders;
+
+        uint64_t total_lines() const
+        {
+            uint64_t total = 0;
+            for (size_t i = 0; i < LEVELS; i++)
+            {
+                total += lines[i];
+            }
+            return total;
+        }
+
+        //按直方图估算百分位耗时(ns),返回所在桶的上界
+        uint64_t percentile(double p) const
+        {
+            if (latency_count == 0)
+            {
+                return 0;
+            }
+            uint64_t target = (uint64_t)(p * latency_count);
+            uint64_t seen = 0;
+            for (size_t i = 0; i < latency_buckets.size(); i++)
+            {
+                seen += latency_buckets[i];
+                if (seen > target)
+                {
+                    uint64_t upper = (uint64_t)2 << i;
+                    return upper < latency_max ? upper : latency_max;
+                }
+            }
+            return latency_max;
+        }
+    };
+
+    //日志器/appender的计数器,全部为原子操作,不需要加锁
+    class LogMetrics
+    {
+    public:
+        LogMetrics()
+        {
+            for (size_t i = 0; i < LogMetricsSnapshot::LEVELS; i++)
+            {
+                lines_[i] = 0;
+            }
+        }
+
+        void add_line(int level, uint64_t bytes)
+        {
+            if (level >= 0 && level < (int)LogMetricsSnapshot::LEVELS)
+            {
+                lines_[level].fetch_add(1, std::memory_order_relaxed);
+            }
+            bytes_.fetch_add(bytes, std::memory_order_relaxed);
+        }
+        void add_suppressed() { suppressed_.fetch_add(1, std::memory_order_relaxed); }
+        void add_dropped() { dropped_.fetch_add(1, std::memory_order_relaxed); }
+        //已经计入输出的日志在之后被丢弃(例如后台线程发送失败),从lines/bytes中扣除并计入dropped
+        void drop_line(int level, uint64_t bytes)
+        {
+            if (level >= 0 && level < (int)LogMetricsSnapshot::LEVELS)
+            {
+                lines_[level].fetch_sub(1, std::memory_order_relaxed);
+            }
+            bytes_.fetch_sub(bytes, std::memory_order_relaxed);
+            add_dropped();
+        }
+        void record_latency(uint64_t ns) { latency_.record(ns); }
+
+        uint64_t get_dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+        void snapshot(LogMetricsSnapshot &snap) const
+        {
+            for (size_t i = 0; i < LogMetricsSnapshot::LEVELS; i++)
+            {
+                snap.lines[i] = lines_[i].load(std::memory_order_relaxed);
+            }
+            snap.bytes = bytes_.load(std::memory_order_relaxed);
+            snap.suppressed = suppressed_.load(std::memory_order_relaxed);
+            snap.dropped = dropped_.load(std::memory_order_relaxed);
+            latency_.snapshot(snap.latency_buckets, snap.latency_count, snap.latency_sum, snap.latency_max);
+        }
+
+    private:
+        std::atomic<uint64_t> lines_[LogMetricsSnapshot::LEVELS];
+        std::atomic<uint64_t> bytes_{0};
+        std::atomic<uint64_t> suppressed_{0};
+        std::atomic<uint64_t> dropped_{0};
+        LatencyHistogram latency_;
+    };
+
+} //end of namespace
+
+#endif
@@ -0,0 +1,191 @@
+#include "log_socket.h"
+#include <yaml-cpp/yaml.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <string.h>
+#include <stddef.h>
+#include <errno.h>
+
+namespace bluesky
+{
+    SocketLogAppender::SocketLogAppender(const std::string &address, size_t max_queue, size_t max_datagram)
+        : address_(address), max_queue_(max_queue), max_datagram_(max_datagram)
+    {
+        memset(&addr_, 0, sizeof(addr_));
+        if (!open_socket())
+        {
+            std::cout << "SocketLogAppender invalid address=" << address_ << std::endl;
+        }
+        thread_.reset(new Thread(std::bind(&SocketLogAppender::run, this), "log_socket"));
+    }
+
+    SocketLogAppender::~SocketLogAppender()
+    {
+        stop();
+        if (fd_ >= 0)
+        {
+            close(fd_);
+        }
+    }
+
+    void SocketLogAppender::stop()
+    {
+        {
+            MutexType::Lock lock(queue_mutex_);
+            if (stopping_)
+            {
+                return;
+            }
+            stopping_ = true;
+        }
+        semaphore_.post();
+        thread_->join();
+    }
+
+    //解析地址并创建非阻塞的数据报socket
+    bool SocketLogAppender::open_socket()
+    {
+        if (address_.compare(0, 5, "unix:") == 0)
+        {
+            std::string path = address_.substr(5);
+            struct sockaddr_un *un = (struct sockaddr_un *)&addr_;
+            if (path.empty() || path.size() >= sizeof(un->sun_path))
+            {
+                return false;
+            }
+            un->sun_family = AF_UNIX;
+            memcpy(un->sun_path, path.c_str(), path.size());
+            addrlen_ = offsetof(struct sockaddr_un, sun_path) + path.size() + 1;
+        }
+        else if (address_.compare(0, 4, "udp:") == 0)
+        {
+            std::string host = address_.substr(4);
+            size_t pos = host.rfind(':');
+            if (pos == std::string::npos)
+            {
+                return false;
+            }
+            struct sockaddr_in *in = (struct sockaddr_in *)&addr_;
+            in->sin_family = AF_INET;
+            in->sin_port = htons(atoi(host.substr(pos + 1).c_str()));
+            if (inet_pton(AF_INET, host.substr(0, pos).c_str(), &in->sin_addr) != 1)
+            {
+                return false;
+            }
+            addrlen_ = sizeof(struct sockaddr_in);
+        }
+        else
+        {
+            return false;
+        }
+        fd_ = socket(addr_.ss_family, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        return fd_ >= 0;
+    }
+
+    std::string SocketLogAppender::toYamlString()
+    {
+        MutexType::Lock lock(mutex_);
+        YAML::Node node;
+        node["type"] = "SocketLogAppender";
+        node["address"] = address_;
+        if (level_ != LogLevel::UNKNOW)
+        {
+            node["level"] = LogLevel::to_string(level_);
+        }
+        if (formatter_)
+        {
+            node["formatter"] = formatter_->get_pattern();
+        }
+        if (filter_)
+        {
+            node["filter"] = filter_->get_expr();
+        }
+        std::stringstream ss;
+        ss << node;
+        return ss.str();
+    }
+
+    bool SocketLogAppender::write(LogLevel::Level level, const std::string &content)
+    {
+        {
+            MutexType::Lock lock(queue_mutex_);
+            if (fd_ < 0 || stopping_ || queue_.size() >= max_queue_)
+            {
+                metrics_.add_dropped();
+                return false;
+            }
+            queue_.push_back(std::make_pair(level, content));
+        }
+        semaphore_.post();
+        return true;
+    }
+
+    //records: 数据报中每条日志的级别和长度,发送失败时从已经计入的输出中扣除
+    void SocketLogAppender::send_batch(const std::string &batch, const std::vector<std::pair<LogLevel::Level, size_t>> &records)
+    {
+        if (records.empty())
+        {
+            return;
+        }
+        ssize_t ret = sendto(fd_, batch.data(), batch.size(), MSG_DONTWAIT | MSG_NOSIGNAL,
+                             (const struct sockaddr *)&addr_, addrlen_);
+        if (ret < 0)
+        {
+            //EAGAIN/ENOBUFS:接收方来不及处理;ECONNREFUSED/ENOENT:接收方不存在,都直接丢弃
+            for (auto &record : records)
+            {
+                metrics_.drop_line(record.first, record.second);
+            }
+            return;
+        }
+        sent_ += records.size();
+    }
+
+    //后台线程:取走队列中的所有日志,按max_datagram_打包成尽量少的数据报发送
+    void SocketLogAppender::run()
+    {
+        std::deque<std::pair<LogLevel::Level, std::string>> items;
+        std::vector<std::pair<LogLevel::Level, size_t>> records;
+        std::string batch;
+        batch.reserve(max_datagram_);
+        while (true)
+        {
+            semaphore_.wait();
+            {
+                MutexType::Lock lock(queue_mutex_);
+                items.swap(queue_);
+            }
+            for (auto &item : items)
+            {
+                const std::string &content = item.second;
+                size_t len = content.size() + (content.empty() || content.back() != '\n' ? 1 : 0);
+                if (!records.empty() && batch.size() + len > max_datagram_)
+                {
+                    send_batch(batch, records);
+                    batch.clear();
+                    records.clear();
+                }
+                batch.append(content);
+                if (len != content.size())
+                {
+                    batch.push_back('\n');
+                }
+                records.push_back(std::make_pair(item.first, content.size()));
+            }
+            send_batch(batch, records);
+            batch.clear();
+            records.clear();
+            items.clear();
+            if (stopping_)
+            {
+                MutexType::Lock lock(queue_mutex_);
+                if (queue_.empty())
+                {
+                    break;
+                }
+            }
+        }
+    }
+
+} //end of namespace
@@ -0,0 +1,61 @@
+#ifndef __BLUESKY_LOG_SOCKET_H__
+#define __BLUESKY_LOG_SOCKET_H__
+
+#include "log.h"
+#include <sys/socket.h>
+
+namespace bluesky
+{
+    /* 数据报日志输出地:把格式化好的日志批量打包,通过AF_UNIX SOCK_DGRAM或UDP发送给本机的日志收集进程
+     * 地址格式:
+     *      unix:/path/to/collector.sock
+     *      udp:127.0.0.1:port
+     * 调用线程只负责放入有界队列,从不阻塞;后台线程使用非阻塞socket发送,
+     * 队列已满或发送失败的日志计入dropped
+     * 每条日志以'\n'结尾,一个数据报中可以包含多条日志
+     */
+    class SocketLogAppender : public LogAppender
+    {
+    public:
+        typedef std::shared_ptr<SocketLogAppender> Ptr;
+
+        SocketLogAppender(const std::string &address, size_t max_queue = 8192, size_t max_datagram = 8192);
+        ~SocketLogAppender();
+
+        virtual std::string toYamlString();
+        virtual bool write(LogLevel::Level level, const std::string &content) override;
+        virtual std::string get_name() const override { return address_; }
+
+        //停止后台线程,队列中剩余的日志会先全部发送;之后写入的日志计入dropped
+        void stop();
+
+        //地址是否解析成功且socket已创建
+        bool is_open() const { return fd_ >= 0; }
+        //已经成功发送的日志条数
+        uint64_t get_sent() const { return sent_; }
+        //队列已满或发送失败而丢弃的日志条数
+        uint64_t get_dropped() const { return metrics_.get_dropped(); }
+
+    private:
+        bool open_socket();
+        void run();
+        void send_batch(const std::string &batch, const std::vector<std::pair<LogLevel::Level, size_t>> &records);
+
+    private:
+        std::string address_;
+        size_t max_queue_;
+        size_t max_datagram_;
+        int fd_ = -1;
+        struct sockaddr_storage addr_;
+        socklen_t addrlen_ = 0;
+        std::deque<std::pair<LogLevel::Level, std::string>> queue_;
+        MutexType queue_mutex_;
+        Semaphore semaphore_;
+        std::atomic<bool> stopping_{false};
+        std::atomic<uint64_t> sent_{0};
+        Thread::Ptr thread_;
+    };
+
+} //end of namespace
+
+#endif
@@ -0,0 +1,407 @@
+#ifndef __BLUESKY_PERSISTENT_MAP_H__
+#define __BLUESKY_PERSISTENT_MAP_H__
+
+#include <memory>
+#include <vector>
+#include <functional>
+#include <stdint.h>
+
+namespace bluesky
+{
+    /* 不可变的哈希映射(HAMT, hash array mapped trie)
+     * 每层取哈希值的5位选择32个分支之一,节点用两个位图分别记录哪些分支直接保存键值对、哪些分支是子节点,
+     * 只为存在的分支分配空间。修改操作返回新的映射,只复制从根到修改位置路径上的节点,其余节点与旧版本共享;
+     * 拷贝映射只复制根指针。删除之后只剩一个键值对的子节点会收回到父节点,相同的键集合总是得到相同的树形,
+     * 两个版本比较(diff/operator==)时跳过共享的子树,开销与变化的数量相关而不是与映射的大小相关。
+     * 哈希值全部用完之后仍然冲突的键放在冲突节点中线性查找
+     */
+    template <class K, class V, class Hash = std::hash<K>>
+    class PersistentMap
+    {
+    public:
+        typedef K key_type;
+        typedef V mapped_type;
+
+        PersistentMap() {}
+
+        size_t size() const { return size_; }
+        bool empty() const { return size_ == 0; }
+
+        //不存在返回nullptr,返回的指针在映射(及其副本)存在期间有效
+        const V *find(const K &key) const
+        {
+            size_t hash = Hash()(key);
+            const Node *node = root_.get();
+            unsigned shift = 0;
+            while (node)
+            {
+                if (is_collision(shift))
+                {
+                    for (auto &leaf : node->leaves)
+                    {
+                        if (leaf.key == key)
+                        {
+                            return &leaf.value;
+                        }
+                    }
+                    return nullptr;
+                }
+                uint32_t b = bit(hash, shift);
+                if (node->datamap & b)
+                {
+                    const Leaf &leaf = node->leaves[index(node->datamap, b)];
+                    return leaf.hash == hash && leaf.key == key ? &leaf.value : nullptr;
+                }
+                if (!(node->nodemap & b))
+                {
+                    return nullptr;
+                }
+                node = node->children[index(node->nodemap, b)].get();
+                shift += kBits;
+            }
+            return nullptr;
+        }
+
+        size_t count(const K &key) const { return find(key) ? 1 : 0; }
+
+        //返回设置之后的新映射,值没有变化时返回的映射与原映射共享全部节点
+        PersistentMap set(const K &key, const V &value) const
+        {
+            const V *old = find(key);
+            if (old && *old == value)
+            {
+                return *this;
+            }
+            Leaf leaf = {Hash()(key), key, value};
+            PersistentMap result;
+            result.root_ = set(root_.get(), leaf, 0);
+            result.size_ = size_ + (old ? 0 : 1);
+            return result;
+        }
+
+        PersistentMap erase(const K &key) const
+        {
+            if (!find(key))
+            {
+                return *this;
+            }
+            PersistentMap result;
+            result.root_ = erase(root_, Hash()(key), key, 0);
+            result.size_ = size_ - 1;
+            return result;
+        }
+
+        //callback(const K &key, const V &value),按哈希值的顺序遍历
+        template <class F>
+        void for_each(F callback) const
+        {
+            visit(root_.get(), callback);
+        }
+
+        /* 比较两个版本,callback(const K &key, const V *old_value, const V *new_value)
+         * 新增的键old_value为nullptr,删除的键new_value为nullptr;指针只在回调期间有效
+         */
+        template <class F>
+        static void diff(const PersistentMap &old_map, const PersistentMap &new_map, F callback)
+        {
+            diff(old_map.root_, new_map.root_, 0, callback);
+        }
+
+        /* 以base为基础应用与target的差异,得到与target内容相同、但与base共享未变化节点的映射
+         * 用于重新加载配置:新解析出来的映射与当前版本合并之后,旧版本释放时只回收变化的部分
+         */
+        static PersistentMap rebase(const PersistentMap &base, const PersistentMap &target)
+        {
+            if (base.root_ == target.root_ || base.empty() || target.empty())
+            {
+                return target;
+            }
+            PersistentMap result = base;
+            diff(base, target, [&result](const K &key, const V *old_value, const V *new_value)
+                 { result = new_value ? result.set(key, *new_value) : result.erase(key); });
+            return result;
+        }
+
+        bool operator==(const PersistentMap &rhs) const
+        {
+            if (root_ == rhs.root_)
+            {
+                return true;
+            }
+            if (size_ != rhs.size_)
+            {
+                return false;
+            }
+            bool equal = true;
+            diff(*this, rhs, [&equal](const K &key, const V *old_value, const V *new_value)
+                 { equal = false; });
+            return equal;
+        }
+
+        bool operator!=(const PersistentMap &rhs) const { return !(*this == rhs); }
+
+    private:
+        struct Leaf
+        {
+            size_t hash;
+            K key;
+            V value;
+        };
+
+        struct Node;
+        typedef std::shared_ptr<const Node> NodePtr;
+
+        //冲突节点只使用leaves
+        struct Node
+        {
+            uint32_t datamap = 0;
+            uint32_t nodemap = 0;
+            std::vector<Leaf> leaves;
+            std::vector<NodePtr> children;
+        };
+
+        static const unsigned kBits = 5;
+
+        static bool is_collision(unsigned shift) { return shift >= sizeof(size_t) * 8; }
+        static uint32_t bit(size_t hash, unsigned shift) { return 1u << ((hash >> shift) & 31); }
+        static unsigned index(uint32_t map, uint32_t b) { return __builtin_popcount(map & (b - 1)); }
+
+        static NodePtr set(const Node *node, const Leaf &leaf, unsigned shift)
+        {
+            std::shared_ptr<Node> copy(node ? new Node(*node) : new Node);
+            if (is_collision(shift))
+            {
+                for (auto &l : copy->leaves)
+                {
+                    if (l.key == leaf.key)
+                    {
+                        l.value = leaf.value;
+                        return copy;
+                    }
+                }
+                copy->leaves.push_back(leaf);
+                return copy;
+            }
+            uint32_t b = bit(leaf.hash, shift);
+            if (copy->datamap & b)
+            {
+                unsigned idx = index(copy->datamap, b);
+                Leaf &l = copy->leaves[idx];
+                if (l.hash == leaf.hash && l.key == leaf.key)
+                {
+                    l.value = leaf.value;
+                    return copy;
+                }
+                //两个键落在同一个分支,下沉到新的子节点
+                NodePtr child = merge(l, leaf, shift + kBits);
+                copy->leaves.erase(copy->leaves.begin() + idx);
+                copy->datamap &= ~b;
+                copy->children.insert(copy->children.begin() + index(copy->nodemap, b), child);
+                copy->nodemap |= b;
+                return copy;
+            }
+            if (copy->nodemap & b)
+            {
+                unsigned idx = index(copy->nodemap, b);
+                copy->children[idx] = set(copy->children[idx].get(), leaf, shift + kBits);
+                return copy;
+            }
+            copy->leaves.insert(copy->leaves.begin() + index(copy->datamap, b), leaf);
+            copy->datamap |= b;
+            return copy;
+        }
+
+        static NodePtr merge(const Leaf &a, const Leaf &b, unsigned shift)
+        {
+            std::shared_ptr<Node> node(new Node);
+            if (is_collision(shift))
+            {
+                node->leaves.push_back(a);
+                node->leaves.push_back(b);
+                return node;
+            }
+            uint32_t ba = bit(a.hash, shift);
+            uint32_t bb = bit(b.hash, shift);
+            if (ba == bb)
+            {
+                node->nodemap = ba;
+                node->children.push_back(merge(a, b, shift + kBits));
+            }
+            else
+            {
+                node->datamap = ba | bb;
+                node->leaves.push_back(ba < bb ? a : b);
+                node->leaves.push_back(ba < bb ? b : a);
+            }
+            return node;
+        }
+
+        //调用方保证key存在;节点删空时返回nullptr
+        static NodePtr erase(const NodePtr &node, size_t hash, const K &key, unsigned shift)
+        {
+            std::shared_ptr<Node> copy(new Node(*node));
+            if (is_collision(shift))
+            {
+                for (size_t i = 0; i < copy->leaves.size(); i++)
+                {
+                    if (copy->leaves[i].key == key)
+                    {
+                        copy->leaves.erase(copy->leaves.begin() + i);
+                        break;
+                    }
+                }
+                return copy->leaves.empty() ? nullptr : copy;
+            }
+            uint32_t b = bit(hash, shift);
+            if (copy->datamap & b)
+            {
+                copy->leaves.erase(copy->leaves.begin() + index(copy->datamap, b));
+                copy->datamap &= ~b;
+            }
+            else
+            {
+                unsigned idx = index(copy->nodemap, b);
+                NodePtr child = erase(copy->children[idx], hash, key, shift + kBits);
+                if (child && (child->nodemap || child->leaves.size() > 1))
+                {
+                    copy->children[idx] = child;
+                }
+                else
+                {
+                    //子节点删空或者只剩一个键值对:收回到当前节点,保持树形唯一
+                    copy->children.erase(copy->children.begin() + idx);
+                    copy->nodemap &= ~b;
+                    if (child)
+                    {
+                        copy->leaves.insert(copy->leaves.begin() + index(copy->datamap, b), child->leaves[0]);
+                        copy->datamap |= b;
+                    }
+                }
+            }
+            return copy->datamap || copy->nodemap ? copy : nullptr;
+        }
+
+        template <class F>
+        static void visit(const Node *node, F &callback)
+        {
+            if (!node)
+            {
+                return;
+            }
+            for (auto &leaf : node->leaves)
+            {
+                callback(leaf.key, leaf.value);
+            }
+            for (auto &child : node->children)
+            {
+                visit(child.get(), callback);
+            }
+        }
+
+        template <class F>
+        static void diff(const NodePtr &a, const NodePtr &b, unsigned shift, F &callback)
+        {
+            if (a == b)
+            {
+                return;
+            }
+            if (!a || !b)
+            {
+                bool removed = a != nullptr;
+                auto cb = [&callback, removed](const K &key, const V &value)
+                {
+                    if (removed)
+                    {
+                        callback(key, &value, nullptr);
+                    }
+                    else
+                    {
+                        callback(key, nullptr, &value);
+                    }
+                };
+                visit(removed ? a.get() : b.get(), cb);
+                return;
+            }
+            if (is_collision(shift))
+            {
+                for (auto &la : a->leaves)
+                {
+                    const Leaf *lb = find_leaf(b->leaves, la.key);
+                    if (!lb)
+                    {
+                        callback(la.key, &la.value, nullptr);
+                    }
+                    else if (!(la.value == lb->value))
+                    {
+                        callback(la.key, &la.value, &lb->value);
+                    }
+                }
+                for (auto &lb : b->leaves)
+                {
+                    if (!find_leaf(a->leaves, lb.key))
+                    {
+                        callback(lb.key, nullptr, &lb.value);
+                    }
+                }
+                return;
+            }
+            uint32_t all = a->datamap | a->nodemap | b->datamap | b->nodemap;
+            while (all)
+            {
+                uint32_t mask = all & (~all + 1);
+                all &= all - 1;
+                const Leaf *la = (a->datamap & mask) ? &a->leaves[index(a->datamap, mask)] : nullptr;
+                const Leaf *lb = (b->datamap & mask) ? &b->leaves[index(b->datamap, mask)] : nullptr;
+                NodePtr na = (a->nodemap & mask) ? a->children[index(a->nodemap, mask)] : nullptr;
+                NodePtr nb = (b->nodemap & mask) ? b->children[index(b->nodemap, mask)] : nullptr;
+                if (la && lb)
+                {
+                    if (la->hash == lb->hash && la->key == lb->key)
+                    {
+                        if (!(la->value == lb->value))
+                        {
+                            callback(la->key, &la->value, &lb->value);
+                        }
+                    }
+                    else
+                    {
+                        callback(la->key, &la->value, nullptr);
+                        callback(lb->key, nullptr, &lb->value);
+                    }
+                }
+                else if (la)
+                {
+                    //一边是键值对,另一边是子节点或者为空:把键值对放到同一层的临时节点中比较
+                    diff(set(nullptr, *la, shift + kBits), nb, shift + kBits, callback);
+                }
+                else if (lb)
+                {
+                    diff(na, set(nullptr, *lb, shift + kBits), shift + kBits, callback);
+                }
+                else
+                {
+                    diff(na, nb, shift + kBits, callback);
+                }
+            }
+        }
+
+        static const Leaf *find_leaf(const std::vector<Leaf> &leaves, const K &key)
+        {
+            for (auto &leaf : leaves)
+            {
+                if (leaf.key == key)
+                {
+                    return &leaf;
+                }
+            }
+            return nullptr;
+        }
+
+    private:
+        NodePtr root_;
+        size_t size_ = 0;
+    };
+
+} //end of namespace
+
+#endif
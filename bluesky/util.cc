@@ -1,6 +1,9 @@
 #include "util.h"
 #include "log.h"
 #include "fiber.h"
+#include <dirent.h>
+#include <sys/stat.h>
+#include <string.h>
 
 namespace bluesky
 {
@@ -13,6 +16,13 @@ namespace bluesky
     {
         return bluesky::Fiber::get_fiberID();
     }
+
+    uint64_t get_current_ns()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    }
     
     void get_backtrace(std::vector<std::string>& bt, int size, int skip)
     {
@@ -44,4 +54,49 @@ namespace bluesky
         }
         return ss.str();
     }
+
+    uint64_t hash_fnv1a(const void *data, size_t size)
+    {
+        const unsigned char *p = (const unsigned char *)data;
+        uint64_t hash = 14695981039346656037ULL;
+        for (size_t i = 0; i < size; i++)
+        {
+            hash ^= p[i];
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
+
+    void list_all_files(std::vector<std::string> &files, const std::string &path, const std::string &suffix)
+    {
+        DIR *dir = opendir(path.c_str());
+        if (!dir)
+        {
+            return;
+        }
+        struct dirent *dp = nullptr;
+        while ((dp = readdir(dir)) != nullptr)
+        {
+            if (!strcmp(dp->d_name, ".") || !strcmp(dp->d_name, ".."))
+            {
+                continue;
+            }
+            std::string file = path + "/" + dp->d_name;
+            struct stat st;
+            if (stat(file.c_str(), &st) != 0)
+            {
+                continue;
+            }
+            if (S_ISDIR(st.st_mode))
+            {
+                list_all_files(files, file, suffix);
+            }
+            else if (S_ISREG(st.st_mode) && file.size() > suffix.size() &&
+                     file.compare(file.size() - suffix.size(), suffix.size(), suffix) == 0)
+            {
+                files.push_back(file);
+            }
+        }
+        closedir(dir);
+    }
 } //end of namespace
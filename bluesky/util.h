@@ -7,6 +7,7 @@
 #include <sys/syscall.h>
 #include <stdint.h>
 #include <execinfo.h>
+#include <time.h>
 #include <string>
 #include <vector>
 
@@ -15,11 +16,20 @@ namespace bluesky{
     pid_t get_threadID();
 
     uint32_t get_fiberID();
+
+    //单调时钟,单位纳秒,用于统计耗时
+    uint64_t get_current_ns();
     
     void get_backtrace(std::vector<std::string>& bt, int size, int skip); 
     
     std::string backtrace_to_string(int size=10, int skip=0, std::string prefix=" ");
 
+    //FNV-1a 64位哈希,用于判断文件内容是否变化
+    uint64_t hash_fnv1a(const void *data, size_t size);
+
+    //递归列出目录path下以suffix结尾的文件
+    void list_all_files(std::vector<std::string> &files, const std::string &path, const std::string &suffix);
+
 } //end of namespace
 
 
@@ -0,0 +1,151 @@
+#include "bluesky/config.h"
+#include "bluesky/util.h"
+#include <random>
+
+/* 容器类型配置的解析、序列化和set_value开销
+ * 每种容器在10到100000个元素下分别测量:
+ *      parse:     LexicalCast<std::string, T>,字符串解析为容器
+ *      serialize: LexicalCast<T, std::string>,容器输出为字符串
+ *      set_value: 发布新值(包括与旧值的比较)
+ * 用法: bench_config [max_size]
+ */
+
+static std::mt19937 s_rand(2024);
+
+template <class C>
+static void fill(C &c, size_t size)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        c.insert(c.end(), (int)s_rand());
+    }
+}
+
+template <class M>
+static void fill_map(M &m, size_t size)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        m["key." + std::to_string(s_rand())] = (int)s_rand();
+    }
+}
+
+static void fill_map(bluesky::PersistentMap<std::string, int> &m, size_t size)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        m = m.set("key." + std::to_string(s_rand()), (int)s_rand());
+    }
+}
+
+/* 修改大映射中的一个键并发布:std::map需要拷贝整个映射,PersistentMap只复制一条路径,
+ * 发布时与旧值的比较也只比较变化的部分
+ */
+template <class M>
+static void bench_update(const std::string &name, size_t size, M value, std::function<M(const M &, int)> update)
+{
+    auto var = bluesky::Config::lookup("bench.update." + name + "." + std::to_string(size), value, name);
+    size_t loops = 100;
+    uint64_t begin = bluesky::get_current_ns();
+    for (size_t i = 0; i < loops; i++)
+    {
+        var->set_value(update(*var->get_snapshot(), (int)i));
+    }
+    printf("%-24s %8zu %14.3f\n", ("update " + name).c_str(), size, (bluesky::get_current_ns() - begin) / loops / 1000.0);
+    fflush(stdout);
+}
+
+template <class T>
+static void bench(const std::string &name, size_t size, const T &value)
+{
+    //元素越多重复次数越少,每项测量的总元素数大致相同
+    size_t loops = std::max<size_t>(1, 100000 / size);
+
+    uint64_t begin = bluesky::get_current_ns();
+    std::string str;
+    for (size_t i = 0; i < loops; i++)
+    {
+        str = bluesky::LexicalCast<T, std::string>()(value);
+    }
+    uint64_t serialize = (bluesky::get_current_ns() - begin) / loops;
+
+    begin = bluesky::get_current_ns();
+    T parsed;
+    for (size_t i = 0; i < loops; i++)
+    {
+        parsed = bluesky::LexicalCast<std::string, T>()(str);
+    }
+    uint64_t parse = (bluesky::get_current_ns() - begin) / loops;
+
+    //配置名称只能包含小写字母、数字、'.'和'_'
+    std::string key = name;
+    for (auto &c : key)
+    {
+        c = isalnum((unsigned char)c) ? tolower(c) : '_';
+    }
+    auto var = bluesky::Config::lookup("bench." + key + "." + std::to_string(size), T(), name);
+    T empty;
+    begin = bluesky::get_current_ns();
+    for (size_t i = 0; i < loops; i++)
+    {
+        var->set_value(i % 2 ? empty : parsed);
+    }
+    uint64_t set_value = (bluesky::get_current_ns() - begin) / loops;
+
+    printf("%-24s %8zu %14.3f %14.3f %14.3f %12zu\n", name.c_str(), size,
+           parse / 1000.0, serialize / 1000.0, set_value / 1000.0, str.size());
+    fflush(stdout);
+}
+
+template <class T>
+static void bench_all(const std::string &name, size_t max_size)
+{
+    for (size_t size = 10; size <= max_size; size *= 10)
+    {
+        T value;
+        fill(value, size);
+        bench(name, size, value);
+    }
+}
+
+template <class T>
+static void bench_all_map(const std::string &name, size_t max_size)
+{
+    for (size_t size = 10; size <= max_size; size *= 10)
+    {
+        T value;
+        fill_map(value, size);
+        bench(name, size, value);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    size_t max_size = argc > 1 ? atoi(argv[1]) : 100000;
+    printf("%-24s %8s %14s %14s %14s %12s\n", "type", "size", "parse(us)", "serialize(us)", "set_value(us)", "bytes");
+    bench_all<std::vector<int>>("vector<int>", max_size);
+    bench_all<std::list<int>>("list<int>", max_size);
+    bench_all<std::set<int>>("set<int>", max_size);
+    bench_all<std::unordered_set<int>>("unordered_set<int>", max_size);
+    bench_all_map<std::map<std::string, int>>("map<string,int>", max_size);
+    bench_all_map<std::unordered_map<std::string, int>>("unordered_map<string,int>", max_size);
+    bench_all_map<bluesky::PersistentMap<std::string, int>>("PersistentMap<string,int>", max_size);
+
+    printf("\n%-24s %8s %14s\n", "type", "size", "update(us)");
+    for (size_t size = 10; size <= max_size; size *= 10)
+    {
+        std::map<std::string, int> map;
+        fill_map(map, size);
+        bench_update<std::map<std::string, int>>("std_map", size, map, [](const std::map<std::string, int> &m, int i)
+                                                 {
+                                                     std::map<std::string, int> copy = m;
+                                                     copy["key.update"] = i;
+                                                     return copy;
+                                                 });
+        bluesky::PersistentMap<std::string, int> pmap;
+        fill_map(pmap, size);
+        bench_update<bluesky::PersistentMap<std::string, int>>("persistent_map", size, pmap, [](const bluesky::PersistentMap<std::string, int> &m, int i)
+                                                               { return m.set("key.update", i); });
+    }
+    return 0;
+}
@@ -0,0 +1,169 @@
+#include "bluesky/config.h"
+#include "bluesky/thread.h"
+#include "bluesky/util.h"
+#include <vector>
+
+/* 比较几种读取配置的方式:
+ *      mutex:    加锁后拷贝整个值(旧版ConfigVar::get_value的实现)
+ *      snapshot: ConfigVar::get_snapshot,原子读取shared_ptr<const T>
+ *      reader:   ConfigVar::Reader,版本号不变时直接使用缓存的快照
+ *      cached:   ConfigCached,全局代数不变时直接使用线程局部的拷贝
+ * 以及按名称查找配置项:加锁的std::map与无锁的ConfigRegistry
+ * 用法: bench_config_read [threads] [loops]
+ */
+
+//旧版的读取方式:每次读取都加锁并拷贝
+template <class T>
+class MutexConfig
+{
+public:
+    MutexConfig(const T &value) : value_(value) {}
+    const T get_value()
+    {
+        bluesky::Mutex::Lock lock(mutex_);
+        return value_;
+    }
+
+private:
+    T value_;
+    bluesky::Mutex mutex_;
+};
+
+typedef std::map<std::string, int> ValueType;
+
+static ValueType make_value()
+{
+    ValueType value;
+    for (int i = 0; i < 32; i++)
+    {
+        value["key." + std::to_string(i)] = i;
+    }
+    return value;
+}
+
+static void run(const std::string &name, int threads, std::function<void()> cb)
+{
+    std::vector<bluesky::Thread::Ptr> workers;
+    uint64_t begin = bluesky::get_current_ns();
+    for (int i = 0; i < threads; i++)
+    {
+        workers.push_back(bluesky::Thread::Ptr(new bluesky::Thread(cb, name + "_" + std::to_string(i))));
+    }
+    for (auto &t : workers)
+    {
+        t->join();
+    }
+    std::cout << name << ": " << (bluesky::get_current_ns() - begin) / 1000000 << "ms" << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+    int threads = argc > 1 ? atoi(argv[1]) : 4;
+    int loops = argc > 2 ? atoi(argv[2]) : 200000;
+    std::atomic<uint64_t> sum{0};
+
+    MutexConfig<ValueType> mutex_config(make_value());
+    bluesky::ConfigVar<ValueType>::Ptr config = bluesky::Config::lookup("bench.read", make_value(), "bench read");
+
+    run("mutex", threads, [&]() {
+        uint64_t s = 0;
+        for (int i = 0; i < loops; i++)
+        {
+            s += mutex_config.get_value().size();
+        }
+        sum += s;
+    });
+
+    run("snapshot", threads, [&]() {
+        uint64_t s = 0;
+        for (int i = 0; i < loops; i++)
+        {
+            s += config->get_snapshot()->size();
+        }
+        sum += s;
+    });
+
+    run("reader", threads, [&]() {
+        uint64_t s = 0;
+        bluesky::ConfigVar<ValueType>::Reader reader(config);
+        for (int i = 0; i < loops; i++)
+        {
+            s += reader.get().size();
+        }
+        sum += s;
+    });
+
+    bluesky::ConfigVar<int>::Ptr small = bluesky::Config::lookup("bench.small", 1024, "bench small");
+    run("small get_value", threads, [&]() {
+        uint64_t s = 0;
+        for (int i = 0; i < loops; i++)
+        {
+            s += small->get_value();
+        }
+        sum += s;
+    });
+
+    bluesky::ConfigCached<int> cached(small);
+    run("small cached", threads, [&]() {
+        uint64_t s = 0;
+        for (int i = 0; i < loops; i++)
+        {
+            s += cached.get();
+        }
+        sum += s;
+    });
+
+    //读的同时有写者不断发布新值
+    std::atomic<bool> stop{false};
+    bluesky::Thread writer([&]() {
+        int n = 0;
+        while (!stop)
+        {
+            ValueType value = make_value();
+            value["version"] = ++n;
+            config->set_value(value);
+            usleep(100);
+        }
+    }, "writer");
+    run("reader+writer", threads, [&]() {
+        uint64_t s = 0;
+        bluesky::ConfigVar<ValueType>::Reader reader(config);
+        for (int i = 0; i < loops; i++)
+        {
+            s += reader.get().size();
+        }
+        sum += s;
+    });
+    stop = true;
+    writer.join();
+
+    //按名称查找配置项:旧版的加锁std::map与无锁哈希表
+    std::map<std::string, bluesky::ConfigVarBase::Ptr> map_configs;
+    bluesky::Mutex map_mutex;
+    std::vector<std::string> names;
+    for (int i = 0; i < 256; i++)
+    {
+        names.push_back("bench.lookup.key" + std::to_string(i));
+        map_configs[names.back()] = bluesky::Config::lookup(names.back(), i, "bench lookup");
+    }
+    run("lookup mutex+map", threads, [&]() {
+        uint64_t s = 0;
+        for (int i = 0; i < loops; i++)
+        {
+            bluesky::Mutex::Lock lock(map_mutex);
+            s += map_configs.find(names[i & 255]) != map_configs.end();
+        }
+        sum += s;
+    });
+    run("lookup registry", threads, [&]() {
+        uint64_t s = 0;
+        for (int i = 0; i < loops; i++)
+        {
+            s += bluesky::Config::get_id(names[i & 255]) != bluesky::ConfigRegistry::npos;
+        }
+        sum += s;
+    });
+
+    std::cout << "checksum=" << sum << std::endl;
+    return 0;
+}
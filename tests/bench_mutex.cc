@@ -0,0 +1,70 @@
+#include "bluesky/locker.h"
+#include "bluesky/thread.h"
+#include "bluesky/util.h"
+#include <iostream>
+#include <vector>
+#include <string>
+#include <stdlib.h>
+#include <stdio.h>
+#include <assert.h>
+
+/* 比较几种锁在不同竞争程度下的开销:
+ *      Mutex:         pthread互斥量
+ *      AdaptiveMutex: 自旋后futex睡眠
+ *      Spinlock:      test-and-test-and-set + 指数退避
+ *      CASLock:       不退避的test_and_set
+ * 每个线程循环加锁,临界区内修改几个共享计数器,总次数固定,线程数从1增加到64
+ * 用法: bench_mutex [loops] [max_threads]
+ */
+
+struct Shared
+{
+    uint64_t counter = 0;
+    uint64_t values[8] = {0};
+};
+
+template <class MutexType>
+static void run(const std::string &name, int threads, uint64_t loops)
+{
+    MutexType mutex;
+    Shared shared;
+    uint64_t per_thread = loops / threads;
+    std::vector<bluesky::Thread::Ptr> workers;
+    uint64_t begin = bluesky::get_current_ns();
+    for (int i = 0; i < threads; i++)
+    {
+        workers.push_back(bluesky::Thread::Ptr(new bluesky::Thread([&mutex, &shared, per_thread]()
+                                                                   {
+                                                                       for (uint64_t n = 0; n < per_thread; n++)
+                                                                       {
+                                                                           typename MutexType::Lock lock(mutex);
+                                                                           shared.counter++;
+                                                                           shared.values[n & 7] += n;
+                                                                       }
+                                                                   },
+                                                                   name + "_" + std::to_string(i))));
+    }
+    for (auto &t : workers)
+    {
+        t->join();
+    }
+    uint64_t elapsed = bluesky::get_current_ns() - begin;
+    assert(shared.counter == per_thread * threads);
+    printf("%-14s threads=%-3d %8.1fms %8.1fns/op\n", name.c_str(), threads, elapsed / 1e6,
+           (double)elapsed / (per_thread * threads));
+    fflush(stdout);
+}
+
+int main(int argc, char **argv)
+{
+    uint64_t loops = argc > 1 ? strtoull(argv[1], nullptr, 10) : 2000000;
+    int max_threads = argc > 2 ? atoi(argv[2]) : 64;
+    for (int threads = 1; threads <= max_threads; threads *= 2)
+    {
+        run<bluesky::Mutex>("Mutex", threads, loops);
+        run<bluesky::AdaptiveMutex>("AdaptiveMutex", threads, loops);
+        run<bluesky::Spinlock>("Spinlock", threads, loops);
+        run<bluesky::CASLock>("CASLock", threads, loops);
+    }
+    return 0;
+}
@@ -0,0 +1,141 @@
+#include "bluesky/bluesky.h"
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <string.h>
+#include <errno.h>
+#include <map>
+
+/* 本机日志收集进程的替身:绑定一个AF_UNIX数据报socket,接收SocketLogAppender发来的日志并校验
+ * 用法: bluesky_logcollector [threads] [lines_per_thread] [max_drop_percent]
+ * 校验内容:
+ *      每条日志格式完整("<thread> <seq>")
+ *      同一线程的序号严格递增(不乱序,不重复)
+ *      received + dropped == 发送总数,并且确实收到了日志
+ *      丢弃的比例不超过max_drop_percent(默认1%),避免全部丢弃也能通过
+ */
+
+static int g_fd = -1;
+static std::map<int, int64_t> g_last_seq;
+static uint64_t g_received = 0;
+static uint64_t g_bad = 0;
+
+static void handle_record(const char *begin, const char *end)
+{
+    int thread = 0;
+    long long seq = 0;
+    std::string record(begin, end);
+    if (sscanf(record.c_str(), "%d %lld", &thread, &seq) != 2)
+    {
+        ++g_bad;
+        return;
+    }
+    auto iter = g_last_seq.find(thread);
+    if (iter != g_last_seq.end() && seq <= iter->second)
+    {
+        ++g_bad;
+    }
+    g_last_seq[thread] = seq;
+    ++g_received;
+}
+
+//接收数据报,直到收齐expected条或者空闲超过idle_ms
+static void receive(uint64_t expected, int idle_ms)
+{
+    static char buf[256 * 1024];
+    while (g_received < expected)
+    {
+        struct pollfd pfd = {g_fd, POLLIN, 0};
+        if (poll(&pfd, 1, idle_ms) <= 0)
+        {
+            break;
+        }
+        ssize_t n = recv(g_fd, buf, sizeof(buf), 0);
+        if (n <= 0)
+        {
+            continue;
+        }
+        const char *begin = buf;
+        const char *end = buf + n;
+        while (begin < end)
+        {
+            const char *nl = (const char *)memchr(begin, '\n', end - begin);
+            if (!nl)
+            {
+                ++g_bad;
+                break;
+            }
+            handle_record(begin, nl);
+            begin = nl + 1;
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int threads = argc > 1 ? atoi(argv[1]) : 4;
+    int lines = argc > 2 ? atoi(argv[2]) : 100000;
+    double max_drop_percent = argc > 3 ? atof(argv[3]) : 1;
+    uint64_t total = (uint64_t)threads * lines;
+
+    std::string path = "/tmp/bluesky_logcollector." + std::to_string(getpid()) + ".sock";
+    g_fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    unlink(path.c_str());
+    if (g_fd < 0 || bind(g_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+    {
+        std::cout << "bind " << path << " failed: " << strerror(errno) << std::endl;
+        return 1;
+    }
+    int rcvbuf = 8 * 1024 * 1024;
+    setsockopt(g_fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+    bluesky::Logger::Ptr logger(new bluesky::Logger("collector"));
+    bluesky::SocketLogAppender::Ptr appender(new bluesky::SocketLogAppender("unix:" + path));
+    appender->set_formatter(bluesky::LogFormatter::Ptr(new bluesky::LogFormatter("%m%n")));
+    logger->add_appender(appender);
+
+    //接收线程与发送线程并行运行,模拟真实的收集进程
+    bluesky::Thread receiver(std::bind(&receive, total, 1000), "collector");
+
+    uint64_t begin = bluesky::get_current_ns();
+    std::vector<bluesky::Thread::Ptr> producers;
+    for (int t = 0; t < threads; t++)
+    {
+        producers.push_back(bluesky::Thread::Ptr(new bluesky::Thread([logger, t, lines]()
+                                                                     {
+                                                                         for (int i = 0; i < lines; i++)
+                                                                         {
+                                                                             BLUESKY_LOG_INFO(logger) << t << " " << i;
+                                                                         }
+                                                                     },
+                                                                     "producer")));
+    }
+    for (auto &p : producers)
+    {
+        p->join();
+    }
+    uint64_t elapse = bluesky::get_current_ns() - begin;
+
+    //停止appender时后台线程会把队列中剩余的日志全部发送完
+    appender->stop();
+    uint64_t dropped = appender->get_dropped();
+    receiver.join();
+    close(g_fd);
+    unlink(path.c_str());
+
+    std::cout << "threads=" << threads << " lines=" << total
+              << " received=" << g_received << " dropped=" << dropped << " bad=" << g_bad
+              << " produce_rate=" << (elapse ? total * 1000000000ULL / elapse : 0) << "/s" << std::endl;
+    if (g_bad != 0 || g_received == 0 || g_received + dropped != total ||
+        dropped * 100.0 > total * max_drop_percent)
+    {
+        std::cout << "FAILED" << std::endl;
+        return 1;
+    }
+    std::cout << "OK" << std::endl;
+    return 0;
+}
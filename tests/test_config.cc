@@ -191,8 +191,10 @@ void test_log()
     static std::shared_ptr<bluesky::Logger> system_log = BLUESKY_LOG_NAME("system");
     BLUESKY_LOG_INFO(system_log) << "hello system";
     std::cout << bluesky::LoggerMgr::get_instance().toYamlString() << std::endl;
+    std::cout << "load files: " << bluesky::Config::load_from_dir("./conf") << std::endl;
+    //文件没有变化,不会重新加载
+    std::cout << "reload files: " << bluesky::Config::load_from_dir("./conf") << std::endl;
     YAML::Node root = YAML::LoadFile("./conf/log.yml");
-    bluesky::Config::load_from_yaml(root);
     std::cout << "=============" << std::endl;
     std::cout << bluesky::LoggerMgr::get_instance().toYamlString() << std::endl;
     std::cout << "=============" << std::endl;
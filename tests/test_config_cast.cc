@@ -0,0 +1,111 @@
+#include "bluesky/config.h"
+#include <assert.h>
+#include <random>
+
+/* LexicalCast/FromNode/ToNode容器特化的往返测试
+ * 随机生成容器,序列化之后再解析回来必须与原值相等;字符串包含YAML的特殊字符
+ * 用法: test_config_cast [seed] [rounds]
+ */
+
+static std::mt19937 s_rand;
+
+static std::string random_string()
+{
+    static const std::vector<std::string> specials = {
+        "", " ", "~", "null", "true", "no", "123", "-1.5", "0x10", "a: b", "- x", "#c", "[1]",
+        "{k: v}", "\"q\"", "'s'", "line\nbreak", "tab\t", " lead", "trail ", "&a", "*a", "!t", "%", "@", "`",
+        "中文", "key.with.dot"};
+    if (s_rand() % 3 == 0)
+    {
+        return specials[s_rand() % specials.size()];
+    }
+    std::string str;
+    size_t len = s_rand() % 16;
+    for (size_t i = 0; i < len; i++)
+    {
+        str.push_back((char)(' ' + s_rand() % 95));
+    }
+    return str;
+}
+
+static int random_int()
+{
+    return (int)s_rand();
+}
+
+static double random_double()
+{
+    return std::uniform_real_distribution<double>(-1e6, 1e6)(s_rand);
+}
+
+template <class C, class F>
+static C random_container(size_t size, F gen)
+{
+    C c;
+    for (size_t i = 0; i < size; i++)
+    {
+        c.insert(c.end(), gen());
+    }
+    return c;
+}
+
+template <class M, class F>
+static M random_map(size_t size, F gen)
+{
+    M m;
+    for (size_t i = 0; i < size; i++)
+    {
+        m[random_string()] = gen();
+    }
+    return m;
+}
+
+//字符串、YAML节点和ConfigVar三条路径都要往返
+template <class T>
+static void check(const std::string &name, const T &value)
+{
+    std::string str = bluesky::LexicalCast<T, std::string>()(value);
+    T parsed = bluesky::LexicalCast<std::string, T>()(str);
+    if (!(parsed == value))
+    {
+        std::cout << name << " round trip failed: " << str << std::endl;
+        assert(false);
+    }
+    T from_node = bluesky::FromNode<T>()(bluesky::ToNode<T>()(value));
+    assert(from_node == value);
+
+    auto var = bluesky::Config::lookup("cast." + name, T(), name);
+    assert(var->fromString(str));
+    assert(var->get_value() == value);
+    assert(var->fromNode(var->toNode()));
+    assert(var->get_value() == value);
+}
+
+int main(int argc, char *argv[])
+{
+    s_rand.seed(argc > 1 ? atoi(argv[1]) : 2024);
+    int rounds = argc > 2 ? atoi(argv[2]) : 200;
+    for (int i = 0; i < rounds; i++)
+    {
+        size_t size = s_rand() % 20;
+        check("vector_int", random_container<std::vector<int>>(size, random_int));
+        check("vector_double", random_container<std::vector<double>>(size, random_double));
+        check("vector_string", random_container<std::vector<std::string>>(size, random_string));
+        check("list_string", random_container<std::list<std::string>>(size, random_string));
+        check("set_int", random_container<std::set<int>>(size, random_int));
+        check("set_string", random_container<std::set<std::string>>(size, random_string));
+        check("unordered_set_string", random_container<std::unordered_set<std::string>>(size, random_string));
+        check("map_int", random_map<std::map<std::string, int>>(size, random_int));
+        check("map_string", random_map<std::map<std::string, std::string>>(size, random_string));
+        check("unordered_map_string", random_map<std::unordered_map<std::string, std::string>>(size, random_string));
+        //嵌套容器
+        check("vector_vector_int", random_container<std::vector<std::vector<int>>>(size, []()
+                                                                                  { return random_container<std::vector<int>>(s_rand() % 5, random_int); }));
+        check("map_vector_string", random_map<std::map<std::string, std::vector<std::string>>>(size, []()
+                                                                                               { return random_container<std::vector<std::string>>(s_rand() % 5, random_string); }));
+        check("map_map_int", random_map<std::map<std::string, std::map<std::string, int>>>(size, []()
+                                                                                           { return random_map<std::map<std::string, int>>(s_rand() % 5, random_int); }));
+    }
+    std::cout << "rounds=" << rounds << " ok" << std::endl;
+    return 0;
+}
@@ -0,0 +1,65 @@
+#include "bluesky/config.h"
+#include <assert.h>
+
+int main(int argc, char *argv[])
+{
+    bluesky::Config::lookup("dump.server.port", 8080, "port");
+    bluesky::Config::lookup("dump.server.host", std::string("0.0.0.0"), "host");
+    bluesky::Config::lookup("dump.server.tags", std::vector<std::string>{"a", "b\"c"}, "tags");
+    bluesky::Config::lookup("dump.servers", 2, "servers");
+    bluesky::Config::lookup("dump.name", std::string("123"), "name");
+
+    //按分段匹配前缀,结果按名称排序
+    std::vector<std::string> names;
+    bluesky::Config::visit_prefix("dump.server", [&names](bluesky::ConfigVarBase::Ptr var)
+                                  { names.push_back(var->get_configname()); });
+    assert(names.size() == 3);
+    assert(names[0] == "dump.server.host" && names[1] == "dump.server.port" && names[2] == "dump.server.tags");
+
+    names.clear();
+    bluesky::Config::visit_prefix("dump.*", [&names](bluesky::ConfigVarBase::Ptr var)
+                                  { names.push_back(var->get_configname()); });
+    assert(names.size() == 5);
+    names.clear();
+    bluesky::Config::visit_prefix("dump.ser", [&names](bluesky::ConfigVarBase::Ptr var)
+                                  { names.push_back(var->get_configname()); });
+    assert(names.empty());
+
+    std::string yaml = bluesky::Config::dump_yaml("dump.server");
+    std::cout << yaml << std::endl;
+    YAML::Node node = YAML::Load(yaml);
+    assert(node["dump"]["server"]["port"].as<int>() == 8080);
+    assert(node["dump"]["server"]["tags"][1].as<std::string>() == "b\"c");
+    assert(!node["dump"]["servers"]);
+
+    std::string json = bluesky::Config::dump_json("dump");
+    std::cout << json << std::endl;
+    assert(json == "{\"dump\":{\"name\":\"123\",\"server\":{\"host\":\"0.0.0.0\",\"port\":8080,"
+                   "\"tags\":[\"a\",\"b\\\"c\"]},\"servers\":2}}");
+    assert(bluesky::Config::dump_json("dump.none") == "{}");
+
+    //遍历与注册并发
+    std::atomic<bool> stop{false};
+    bluesky::Thread writer([&stop]()
+                           {
+                               for (int i = 0; i < 2000; i++)
+                               {
+                                   bluesky::Config::lookup("dump.extra.key" + std::to_string(i), i, "extra");
+                               }
+                               stop = true;
+                           },
+                           "writer");
+    while (!stop)
+    {
+        size_t count = 0;
+        bluesky::Config::visit_prefix("dump.extra", [&count](bluesky::ConfigVarBase::Ptr var)
+                                      { ++count; });
+        assert(count <= 2000);
+    }
+    writer.join();
+    size_t count = 0;
+    bluesky::Config::visit_prefix("dump.extra", [&count](bluesky::ConfigVarBase::Ptr var)
+                                  { ++count; });
+    assert(count == 2000);
+    return 0;
+}
@@ -0,0 +1,72 @@
+#include "bluesky/config.h"
+#include <assert.h>
+
+int main(int argc, char *argv[])
+{
+    auto port = bluesky::Config::lookup("history.port", 80, "port");
+    auto ip = bluesky::Config::lookup("history.ip", std::string("0.0.0.0"), "ip");
+    auto workers = bluesky::Config::lookup("history.workers", 4, bluesky::ConfigRule<int>().min(1), "workers");
+
+    int port_calls = 0;
+    int ip_calls = 0;
+    port->add_listener([&port_calls](const int &old_value, const int &new_value)
+                       { port_calls++; });
+    ip->add_listener([&ip_calls](const std::string &old_value, const std::string &new_value)
+                     { ip_calls++; });
+
+    //启动时的初始状态是代数0
+    std::vector<uint64_t> generations = bluesky::ConfigHistory::get_generations();
+    assert(generations.size() == 1 && generations[0] == 0);
+
+    port->set_value(8080);
+    uint64_t gen1 = bluesky::ConfigTransaction::get_generation();
+    {
+        bluesky::ConfigTransaction transaction;
+        transaction.set(port, 9090);
+        transaction.set(ip, std::string("127.0.0.1"));
+        assert(transaction.commit() == 2);
+    }
+    uint64_t gen2 = bluesky::ConfigTransaction::get_generation();
+    workers->set_value(8);
+    generations = bluesky::ConfigHistory::get_generations();
+    assert(generations.size() == 4 && generations[1] == gen1 && generations[2] == gen2);
+
+    //只有与目标版本不同的配置项被修改和通知
+    port_calls = ip_calls = 0;
+    assert(bluesky::Config::rollback(gen2));
+    assert(port->get_value() == 9090 && ip->get_value() == "127.0.0.1" && workers->get_value() == 4);
+    assert(port_calls == 0 && ip_calls == 0);
+
+    //回滚本身是一次新的发布,可以再回滚回去
+    uint64_t gen3 = bluesky::ConfigTransaction::get_generation();
+    assert(bluesky::Config::rollback(gen1));
+    assert(port->get_value() == 8080 && ip->get_value() == "0.0.0.0");
+    assert(port_calls == 1 && ip_calls == 1);
+    assert(bluesky::Config::rollback(gen3));
+    assert(port->get_value() == 9090 && ip->get_value() == "127.0.0.1" && workers->get_value() == 4);
+
+    //回滚到初始状态:从未在目标版本中出现的配置项恢复为第一次修改之前的值
+    assert(bluesky::Config::rollback(0));
+    assert(port->get_value() == 80 && ip->get_value() == "0.0.0.0" && workers->get_value() == 4);
+
+    //回滚发布的是历史中保存的快照,不复制值
+    std::shared_ptr<const int> snapshot = port->get_snapshot();
+    uint64_t gen4 = bluesky::ConfigTransaction::get_generation();
+    port->set_value(1);
+    assert(bluesky::Config::rollback(gen4));
+    assert(port->get_snapshot() == snapshot);
+
+    //超出保留数量的版本被丢弃,不能再回滚
+    assert(!bluesky::Config::rollback(bluesky::ConfigTransaction::get_generation() + 2));
+    bluesky::ConfigHistory::set_capacity(3);
+    for (int i = 0; i < 10; i++)
+    {
+        port->set_value(1000 + i);
+    }
+    generations = bluesky::ConfigHistory::get_generations();
+    assert(generations.size() == 3);
+    assert(!bluesky::Config::rollback(gen1));
+    assert(bluesky::Config::rollback(generations[0]));
+    assert(port->get_value() == 1007);
+    return 0;
+}
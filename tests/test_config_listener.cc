@@ -0,0 +1,95 @@
+#include "bluesky/config.h"
+#include <assert.h>
+
+int main(int argc, char *argv[])
+{
+    //回调在锁外执行:回调中读取和修改自身不会死锁
+    auto port = bluesky::Config::lookup("listener.port", 80, "port");
+    port->add_listener([&port](const int &old_value, const int &new_value)
+                       {
+                           assert(port->get_value() == new_value);
+                           if (new_value < 1024)
+                           {
+                               port->set_value(1024);
+                           }
+                       });
+    port->set_value(90);
+    assert(port->get_value() == 1024);
+
+    //慢回调不阻塞读取
+    auto slow = bluesky::Config::lookup("listener.slow", 0, "slow");
+    slow->add_listener([](const int &old_value, const int &new_value)
+                       { usleep(200 * 1000); });
+    bluesky::Thread writer([&slow]()
+                           { slow->set_value(1); }, "writer");
+    usleep(50 * 1000);
+    uint64_t begin = bluesky::get_current_ns();
+    assert(slow->get_value() == 1);
+    assert(bluesky::get_current_ns() - begin < 50 * 1000 * 1000);
+    writer.join();
+
+    //两个线程并发修改同一个配置项:回调不交错,按发布顺序执行,每次的旧值都是上一次的新值
+    auto ordered = bluesky::Config::lookup("listener.ordered", 0, "ordered");
+    std::atomic<int> running{0};
+    std::vector<std::pair<int, int>> ordered_changes;
+    ordered->add_listener([&running, &ordered_changes](const int &old_value, const int &new_value)
+                          {
+                              assert(++running == 1);
+                              usleep(100);
+                              ordered_changes.push_back(std::make_pair(old_value, new_value));
+                              --running;
+                          });
+    std::vector<bluesky::Thread::Ptr> writers;
+    for (int w = 0; w < 2; w++)
+    {
+        writers.push_back(bluesky::Thread::Ptr(new bluesky::Thread([&ordered, w]()
+                                                                   {
+                                                                       for (int i = 1; i <= 200; i++)
+                                                                       {
+                                                                           ordered->set_value(w * 1000 + i);
+                                                                       }
+                                                                   },
+                                                                   "writer_" + std::to_string(w))));
+    }
+    for (auto &t : writers)
+    {
+        t->join();
+    }
+    assert(ordered_changes.size() == 400);
+    assert(ordered_changes.front().first == 0 && ordered_changes.back().second == ordered->get_value());
+    for (size_t i = 1; i < ordered_changes.size(); i++)
+    {
+        assert(ordered_changes[i].first == ordered_changes[i - 1].second);
+    }
+
+    //异步模式:连续的变更合并成一次从最初旧值到最新值的通知
+    auto async = bluesky::Config::lookup("listener.async", 0, "async");
+    async->set_async_notify(true);
+    std::vector<std::pair<int, int>> changes;
+    async->add_listener([&changes](const int &old_value, const int &new_value)
+                        {
+                            usleep(10 * 1000);
+                            changes.push_back(std::make_pair(old_value, new_value));
+                        });
+    for (int i = 1; i <= 100; i++)
+    {
+        async->set_value(i);
+    }
+    bluesky::ConfigNotifier::get_instance().flush();
+    std::cout << "async notifications=" << changes.size() << std::endl;
+    assert(!changes.empty() && changes.size() < 100);
+    assert(changes.front().first == 0 && changes.back().second == 100);
+    for (size_t i = 1; i < changes.size(); i++)
+    {
+        assert(changes[i].first == changes[i - 1].second);
+    }
+
+    //停止时先执行完已经提交的通知再join通知线程,之后的通知在调用线程中执行
+    async->set_value(101);
+    bluesky::ConfigNotifier::get_instance().stop();
+    assert(changes.back().second == 101);
+    async->set_value(102);
+    assert(changes.back() == std::make_pair(101, 102));
+
+    return 0;
+}
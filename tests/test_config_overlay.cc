@@ -0,0 +1,47 @@
+#include "bluesky/config.h"
+#include <assert.h>
+#include <stdlib.h>
+
+int main(int argc, char *argv[])
+{
+    auto port = bluesky::Config::lookup("overlay.port", 80, "port");
+    auto host = bluesky::Config::lookup("overlay.host", std::string("localhost"), "host");
+    auto name = bluesky::Config::lookup("overlay.name", std::string("default"), "name");
+    auto stack_size = bluesky::Config::lookup("overlay.stack_size", 1024, "stack size");
+    assert(port->get_source() == bluesky::ConfigSource::DEFAULT);
+
+    //转换失败时全部覆盖值都不生效
+    setenv("BLUESKY_OVERLAY_PORT", "abc", 1);
+    setenv("BLUESKY_OVERLAY_STACK_SIZE", "2048", 1);
+    assert(!bluesky::Config::load_overlays(0, nullptr));
+    assert(port->get_value() == 80 && stack_size->get_value() == 1024);
+
+    //命令行优先于环境变量
+    setenv("BLUESKY_OVERLAY_PORT", "81", 1);
+    setenv("BLUESKY_OVERLAY_HOST", "env.host", 1);
+    const char *args[] = {"test", "--overlay.host=arg.host", "--unknown=1", "-v"};
+    assert(bluesky::Config::load_overlays(4, (char **)args));
+    assert(port->get_value() == 81 && port->get_source() == bluesky::ConfigSource::ENV);
+    assert(stack_size->get_value() == 2048);
+    assert(host->get_value() == "arg.host" && host->get_source() == bluesky::ConfigSource::ARGV);
+
+    //配置文件不覆盖环境变量和命令行
+    assert(bluesky::Config::load_from_yaml(YAML::Load("overlay:\n  port: 90\n  host: file.host\n  name: file\n")));
+    assert(port->get_value() == 81 && host->get_value() == "arg.host");
+    assert(name->get_value() == "file" && name->get_source() == bluesky::ConfigSource::FILE);
+
+    //运行时设置总是生效
+    port->set_value(82);
+    assert(port->get_value() == 82 && port->get_source() == bluesky::ConfigSource::RUNTIME);
+
+    std::function<void(bluesky::ConfigVarBase::Ptr)> cb = [](bluesky::ConfigVarBase::Ptr var)
+    {
+        if (var->get_configname().compare(0, 8, "overlay.") == 0)
+        {
+            std::cout << var->get_configname() << "=" << var->toString()
+                      << " source=" << bluesky::ConfigSource::to_string(var->get_source()) << std::endl;
+        }
+    };
+    bluesky::Config::visit_configs(cb);
+    return 0;
+}
@@ -0,0 +1,52 @@
+#include "bluesky/config.h"
+#include <assert.h>
+
+int main(int argc, char *argv[])
+{
+    auto port = bluesky::Config::lookup("rule.port", 80,
+                                        bluesky::ConfigRule<int>().min(1).max(65535), "port");
+    auto mode = bluesky::Config::lookup("rule.mode", std::string("fast"),
+                                        bluesky::ConfigRule<std::string>().one_of({"fast", "safe"}), "mode");
+    auto even = bluesky::Config::lookup("rule.even", 2,
+                                        bluesky::ConfigRule<int>().validator([](const int &value, std::string &error)
+                                                                             {
+                                                                                 error = "must be even";
+                                                                                 return value % 2 == 0;
+                                                                             })
+                                            .restart_required(),
+                                        "even");
+    assert(!port->is_restart_required() && even->is_restart_required());
+
+    //fromString/set_value不接受违反约束或者无法转换的值
+    assert(!port->fromString("0"));
+    assert(!port->fromString("abc"));
+    assert(!port->set_value(70000));
+    assert(port->fromString("8080"));
+    assert(port->get_value() == 8080);
+    assert(!mode->fromString("slow"));
+    assert(mode->get_value() == "fast");
+    assert(!even->set_value(3));
+    assert(even->set_value(4));
+
+    //一个配置项校验失败,整个更新都被拒绝
+    assert(!bluesky::Config::load_from_yaml(YAML::Load("rule:\n  port: 9090\n  mode: slow\n  even: 5\n")));
+    assert(port->get_value() == 8080 && mode->get_value() == "fast" && even->get_value() == 4);
+
+    bluesky::ConfigTransaction transaction;
+    transaction.set(port, 9090);
+    transaction.set(mode, std::string("slow"));
+    transaction.set_string(even, "7");
+    assert(transaction.get_errors().size() == 2);
+    assert(transaction.commit() == 0);
+    assert(port->get_value() == 8080);
+
+    assert(bluesky::Config::load_from_yaml(YAML::Load("rule:\n  port: 9090\n  mode: safe\n  even: 6\n")));
+    assert(port->get_value() == 9090 && mode->get_value() == "safe" && even->get_value() == 6);
+
+    //协程栈大小有上下限
+    auto stack_size = bluesky::Config::lookup<uint32_t>("fiber.stack_size");
+    assert(stack_size);
+    assert(!bluesky::Config::load_from_yaml(YAML::Load("fiber:\n  stack_size: 10\n")));
+    assert(stack_size->get_value() == 1024 * 1024);
+    return 0;
+}
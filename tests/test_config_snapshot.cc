@@ -0,0 +1,101 @@
+#include "bluesky/config_snapshot.h"
+#include "bluesky/util.h"
+#include <assert.h>
+#include <fstream>
+#include <unistd.h>
+
+int main(int argc, char *argv[])
+{
+    const int N = 500;
+    std::string dir = "/tmp/bluesky_config_snapshot";
+    std::string snapshot = dir + ".snap";
+    system(("rm -rf " + dir + " " + snapshot + " && mkdir -p " + dir).c_str());
+    {
+        std::ofstream ofs(dir + "/app.yml");
+        ofs << "app:\n";
+        for (int i = 0; i < N; i++)
+        {
+            ofs << "  value" << i << ": " << i * 3 << "\n";
+        }
+        ofs << "  name: snapshot\n  ratio: 0.25\n  servers:\n    a: [1, 2, 3]\n    b: [4]\n";
+    }
+
+    std::vector<bluesky::ConfigVar<int>::Ptr> values;
+    for (int i = 0; i < N; i++)
+    {
+        values.push_back(bluesky::Config::lookup("app.value" + std::to_string(i), 0, "value"));
+    }
+    auto name = bluesky::Config::lookup("app.name", std::string(), "name");
+    auto ratio = bluesky::Config::lookup("app.ratio", 0.0, "ratio");
+    auto servers = bluesky::Config::lookup("app.servers", std::map<std::string, std::vector<int>>(), "servers");
+
+    //第一次启动:没有快照,解析yaml并生成快照
+    uint64_t begin = bluesky::get_current_ns();
+    assert(!bluesky::ConfigSnapshot::load(snapshot, dir));
+    assert(bluesky::ConfigSnapshot::load_or_build(snapshot, dir));
+    std::cout << "yaml load + save: " << (bluesky::get_current_ns() - begin) / 1000 << "us" << std::endl;
+    assert(values[10]->get_value() == 30 && name->get_value() == "snapshot");
+
+    //模拟重新启动:恢复默认值后从快照加载
+    for (auto &v : values)
+    {
+        v->set_value(0);
+    }
+    name->set_value("");
+    ratio->set_value(0);
+    servers->set_value(std::map<std::string, std::vector<int>>());
+    //环境变量覆盖的值不能被快照中的文件值覆盖
+    bluesky::ConfigTransaction overlay(bluesky::ConfigSource::ENV);
+    overlay.set(values[1], 7);
+    assert(overlay.commit() == 1);
+    uint64_t generation = bluesky::ConfigTransaction::get_generation();
+    begin = bluesky::get_current_ns();
+    assert(bluesky::ConfigSnapshot::load(snapshot, dir));
+    std::cout << "snapshot load: " << (bluesky::get_current_ns() - begin) / 1000 << "us" << std::endl;
+    //所有配置项在一次发布中生效
+    assert(bluesky::ConfigTransaction::get_generation() == generation + 2);
+    assert(values[1]->get_value() == 7 && values[1]->get_source() == bluesky::ConfigSource::ENV);
+    assert(values[2]->get_value() == 6 && values[2]->get_source() == bluesky::ConfigSource::FILE);
+    assert(values[N - 1]->get_value() == (N - 1) * 3);
+    assert(name->get_value() == "snapshot" && ratio->get_value() == 0.25);
+    assert(servers->get_snapshot()->at("a").size() == 3);
+
+    begin = bluesky::get_current_ns();
+    bluesky::Config::load_from_dir(dir, true);
+    std::cout << "yaml load: " << (bluesky::get_current_ns() - begin) / 1000 << "us" << std::endl;
+
+    //运行时的修改和文件中没有的配置项不进入快照
+    auto local = bluesky::Config::lookup("app.local", 5, "local");
+    local->set_value(6);
+    values[3]->set_value(999);
+    assert(bluesky::ConfigSnapshot::save(snapshot, dir));
+    local->set_value(8);
+    assert(bluesky::ConfigSnapshot::load(snapshot, dir));
+    assert(values[3]->get_value() == 9 && values[3]->get_source() == bluesky::ConfigSource::FILE);
+    assert(local->get_value() == 8);
+
+    //注册的配置项变化后快照失效
+    bluesky::Config::lookup("app.other", 0, "other");
+    assert(!bluesky::ConfigSnapshot::load(snapshot, dir));
+    assert(bluesky::ConfigSnapshot::save(snapshot, dir));
+    assert(bluesky::ConfigSnapshot::load(snapshot, dir));
+
+    //配置文件变化后快照失效
+    {
+        std::ofstream ofs(dir + "/app.yml", std::ios::app);
+        ofs << "  extra: 1\n";
+    }
+    assert(!bluesky::ConfigSnapshot::load(snapshot, dir));
+
+    //配置文件被拒绝时不生成快照
+    {
+        std::ofstream ofs(dir + "/bad.yml");
+        ofs << "app:\n  value0: abc\n";
+    }
+    unlink(snapshot.c_str());
+    assert(!bluesky::ConfigSnapshot::load_or_build(snapshot, dir));
+    assert(access(snapshot.c_str(), F_OK) != 0);
+
+    system(("rm -rf " + dir + " " + snapshot).c_str());
+    return 0;
+}
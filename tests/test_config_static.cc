@@ -0,0 +1,35 @@
+#include "bluesky/config.h"
+#include <assert.h>
+
+//静态初始化阶段定义,不访问注册表
+static bluesky::ConfigStatic<int> g_port("static.port", 80, "port");
+static bluesky::ConfigStatic<int> g_workers("static.workers", 4, bluesky::ConfigRule<int>().min(1), "workers");
+static bluesky::ConfigStatic<int> g_invalid("static.invalid-name", 0, "invalid");
+static bluesky::ConfigCached<int> g_port_cached(g_port);
+
+int main(int argc, char *argv[])
+{
+    //还没有访问过注册表
+    assert(g_port->get_id() == bluesky::ConfigRegistry::npos);
+    assert(g_port->get_value() == 80);
+
+    //第一次访问注册表时按定义顺序注册
+    assert(bluesky::Config::lookup_base("static.port") == g_port.get());
+    assert(g_workers->get_id() == g_port->get_id() + 1);
+    assert(bluesky::Config::lookup<int>("static.workers", 8) == g_workers.get());
+    assert(g_workers->get_value() == 4);
+    //名称不合法的不注册
+    assert(g_invalid->get_id() == bluesky::ConfigRegistry::npos);
+    assert(!bluesky::Config::lookup_base("static.invalid-name"));
+
+    //库中静态定义的配置项
+    auto stack_size = bluesky::Config::lookup<uint32_t>("fiber.stack_size");
+    assert(stack_size && !stack_size->fromString("1024"));
+
+    //约束和加载与Config::lookup定义的配置项相同
+    assert(!bluesky::Config::load_from_yaml(YAML::Load("static:\n  workers: 0\n")));
+    assert(bluesky::Config::load_from_yaml(YAML::Load("static:\n  port: 8080\n  workers: 2\n")));
+    assert(g_port->get_value() == 8080 && g_workers->get_value() == 2);
+    assert(g_port_cached.get() == 8080);
+    return 0;
+}
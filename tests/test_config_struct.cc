@@ -0,0 +1,103 @@
+#include "bluesky/config_struct.h"
+#include <assert.h>
+
+struct TimeoutConf
+{
+    int connect = 100;
+    int read = 1000;
+};
+
+struct ServerConf
+{
+    int port = 80;
+    std::string ip = "0.0.0.0";
+    std::vector<int> backlog;
+    TimeoutConf timeout;
+};
+
+BLUESKY_CONFIG_STRUCT(TimeoutConf, connect, read)
+BLUESKY_CONFIG_STRUCT(ServerConf, port, ip, backlog, timeout)
+
+//绑定的结构体作为容器的元素
+struct Up
+{
+    std::string host;
+    int weight = 1;
+};
+
+struct Pool
+{
+    std::vector<Up> ups;
+};
+
+BLUESKY_CONFIG_STRUCT(Up, host, weight)
+BLUESKY_CONFIG_STRUCT(Pool, ups)
+
+int main(int argc, char *argv[])
+{
+    auto server = bluesky::Config::lookup("server", ServerConf(), "server");
+    int calls = 0;
+    server->add_listener([&calls](const ServerConf &old_value, const ServerConf &new_value)
+                         { calls++; });
+
+    //整个子树作为一个值发布,只通知一次
+    bluesky::Config::load_from_yaml(YAML::Load("server:\n"
+                                               "  port: 8080\n"
+                                               "  ip: 127.0.0.1\n"
+                                               "  backlog: [1, 2]\n"
+                                               "  timeout:\n"
+                                               "    read: 50\n"
+                                               "  unknown: 1\n"));
+    std::shared_ptr<const ServerConf> conf = server->get_snapshot();
+    assert(conf->port == 8080 && conf->ip == "127.0.0.1");
+    assert(conf->backlog == std::vector<int>({1, 2}));
+    //缺少的键取默认值
+    assert(conf->timeout.connect == 100 && conf->timeout.read == 50);
+    assert(calls == 1);
+
+    //值相同不发布
+    assert(server->fromString(server->toString()));
+    assert(server->get_snapshot() == conf);
+    assert(calls == 1);
+
+    //字段转换失败时整个值被拒绝
+    assert(!bluesky::Config::load_from_yaml(YAML::Load("server:\n  port: abc\n  ip: 10.0.0.1\n")));
+    assert(server->get_snapshot() == conf);
+    assert(!server->fromString("8080"));
+
+    //字符串与节点的双向转换
+    YAML::Node node = server->toNode();
+    assert(node["port"].as<int>() == 8080 && node["timeout"]["read"].as<int>() == 50);
+    ServerConf copy = bluesky::LexicalCast<std::string, ServerConf>()(server->toString());
+    assert(bluesky::ConfigEqual<ServerConf>()(copy, *conf));
+    copy.timeout.connect = 1;
+    assert(!bluesky::ConfigEqual<ServerConf>()(copy, *conf));
+    assert(server->set_value(copy));
+    assert(server->get_value().timeout.connect == 1 && calls == 2);
+
+    auto pool = bluesky::Config::lookup("pool", Pool(), "pool");
+    assert(bluesky::Config::load_from_yaml(YAML::Load("pool:\n"
+                                                      "  ups:\n"
+                                                      "    - host: a\n"
+                                                      "      weight: 2\n"
+                                                      "    - host: b\n")));
+    std::shared_ptr<const Pool> p = pool->get_snapshot();
+    assert(p->ups.size() == 2 && p->ups[0].weight == 2 && p->ups[1].host == "b" && p->ups[1].weight == 1);
+    assert(pool->fromString(pool->toString()));
+    assert(pool->get_snapshot() == p);
+
+    auto ups = bluesky::Config::lookup("ups", std::vector<Up>(), "ups");
+    int ups_calls = 0;
+    ups->add_listener([&ups_calls](const std::vector<Up> &old_value, const std::vector<Up> &new_value)
+                      { ups_calls++; });
+    assert(ups->set_value(p->ups));
+    assert(ups_calls == 1);
+    //元素逐个比较,值相同不通知
+    assert(ups->fromString(ups->toString()));
+    assert(ups_calls == 1);
+    std::vector<Up> changed = p->ups;
+    changed[1].weight = 3;
+    assert(ups->set_value(changed));
+    assert(ups_calls == 2 && ups->get_value()[1].weight == 3);
+    return 0;
+}
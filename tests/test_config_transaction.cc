@@ -0,0 +1,88 @@
+#include "bluesky/config.h"
+#include <assert.h>
+
+int main(int argc, char *argv[])
+{
+    auto port = bluesky::Config::lookup("transaction.port", 0, "port");
+    auto ip = bluesky::Config::lookup("transaction.ip", std::string("0"), "ip");
+
+    //回调执行时事务中的其它配置项已经发布
+    port->add_listener([&ip](const int &old_value, const int &new_value)
+                       { assert(ip->get_value() == std::to_string(new_value)); });
+
+    //没有提交的事务不生效
+    {
+        bluesky::ConfigTransaction transaction;
+        transaction.set(port, 1);
+        transaction.set(ip, std::string("1"));
+    }
+    assert(port->get_value() == 0 && ip->get_value() == "0");
+
+    //有转换失败的值时整个事务被拒绝
+    {
+        bluesky::ConfigTransaction transaction;
+        assert(transaction.set_string(ip, "2"));
+        assert(!transaction.set_string(port, "abc"));
+        assert(transaction.has_error());
+        assert(transaction.commit() == 0);
+    }
+    assert(port->get_value() == 0 && ip->get_value() == "0");
+
+    {
+        bluesky::ConfigTransaction transaction;
+        assert(transaction.set_string(port, "2"));
+        assert(transaction.set_node(ip, YAML::Load("2")));
+        assert(transaction.size() == 2);
+        assert(transaction.commit() == 2);
+        assert(transaction.size() == 0);
+    }
+    assert(port->get_value() == 2 && ip->get_value() == "2");
+
+    //load_from_yaml整体作为一个事务
+    uint64_t generation = bluesky::ConfigTransaction::get_generation();
+    bluesky::Config::load_from_yaml(YAML::Load("transaction:\n  port: 3\n  ip: \"3\"\n"));
+    assert(port->get_value() == 3 && ip->get_value() == "3");
+    assert(bluesky::ConfigTransaction::get_generation() == generation + 2);
+
+    //线程局部缓存在任何发布之后刷新
+    auto timeout = bluesky::Config::lookup("transaction.timeout", 3, "timeout");
+    bluesky::ConfigCached<int> cached(timeout);
+    assert(cached.get() == 3);
+    timeout->set_value(4);
+    assert(cached.get() == 4);
+    bluesky::Thread reader([&cached]()
+                           { assert(cached.get() == 4); },
+                           "reader");
+    reader.join();
+
+    //并发读取:consistent_read中不会看到两个配置项来自不同的事务
+    std::atomic<bool> stop{false};
+    bluesky::Thread writer([&]()
+                           {
+                               for (int i = 4; i < 20000; i++)
+                               {
+                                   bluesky::ConfigTransaction transaction;
+                                   transaction.set(port, i);
+                                   transaction.set(ip, std::to_string(i));
+                                   transaction.commit();
+                               }
+                               stop = true;
+                           },
+                           "writer");
+    uint64_t reads = 0;
+    while (!stop)
+    {
+        int p = 0;
+        std::string i;
+        bluesky::Config::consistent_read([&]()
+                                         {
+                                             p = port->get_value();
+                                             i = ip->get_value();
+                                         });
+        assert(std::to_string(p) == i);
+        ++reads;
+    }
+    writer.join();
+    std::cout << "consistent reads=" << reads << std::endl;
+    return 0;
+}
@@ -0,0 +1,71 @@
+#include "bluesky/config_watcher.h"
+#include <assert.h>
+#include <fstream>
+#include <unistd.h>
+
+static void write_file(const std::string &file, const std::string &content)
+{
+    std::ofstream ofs(file, std::ios::trunc);
+    ofs << content;
+}
+
+int main(int argc, char *argv[])
+{
+    std::string dir = "/tmp/bluesky_config_watcher";
+    system(("rm -rf " + dir + " && mkdir -p " + dir).c_str());
+    write_file(dir + "/server.yml", "server:\n  port: 8080\n  name: a\n");
+    write_file(dir + "/log.yml", "server:\n  threads: 4\n");
+
+    auto port = bluesky::Config::lookup("server.port", 0, "server port");
+    auto name = bluesky::Config::lookup("server.name", std::string(), "server name");
+    auto threads = bluesky::Config::lookup("server.threads", 0, "server threads");
+    int name_changes = 0;
+    name->add_listener([&name_changes](const std::string &old_value, const std::string &new_value)
+                       { ++name_changes; });
+    int threads_changes = 0;
+    threads->add_listener([&threads_changes](const int &old_value, const int &new_value)
+                          { ++threads_changes; });
+
+    assert(bluesky::Config::load_from_dir(dir) == 2);
+    assert(port->get_value() == 8080 && name->get_value() == "a" && threads->get_value() == 4);
+    assert(name_changes == 1 && threads_changes == 1);
+
+    bluesky::ConfigWatcher watcher(dir, 100);
+    assert(watcher.start());
+
+    //连续写入只触发一次加载,只有port变化
+    for (int i = 0; i < 5; i++)
+    {
+        write_file(dir + "/server.yml", "server:\n  port: " + std::to_string(9000 + i) + "\n  name: a\n");
+        usleep(10 * 1000);
+    }
+    usleep(500 * 1000);
+    std::cout << "reloads=" << watcher.get_reloads() << " port=" << port->get_value() << std::endl;
+    assert(watcher.get_reloads() == 1);
+    assert(port->get_value() == 9004);
+    assert(name_changes == 1 && threads_changes == 1);
+
+    //新建子目录中的文件覆盖前面的配置
+    system(("mkdir -p " + dir + "/z").c_str());
+    usleep(300 * 1000);
+    write_file(dir + "/z/override.yaml", "server:\n  threads: 8\n");
+    usleep(500 * 1000);
+    std::cout << "reloads=" << watcher.get_reloads() << " threads=" << threads->get_value() << std::endl;
+    assert(threads->get_value() == 8 && threads_changes == 2);
+
+    watcher.stop();
+
+    //删除的文件和键不再生效,路径写法不同(末尾的'/')也能找到缓存的文件
+    unlink((dir + "/z/override.yaml").c_str());
+    bluesky::Config::load_from_dir(dir + "/");
+    assert(threads->get_value() == 4 && threads_changes == 3);
+    write_file(dir + "/server.yml", "server:\n  port: 9004\n");
+    bluesky::Config::load_from_dir(dir + "/");
+    assert(name->get_value() == "" && name->get_source() == bluesky::ConfigSource::DEFAULT && name_changes == 2);
+    unlink((dir + "/log.yml").c_str());
+    bluesky::Config::load_from_dir("/tmp/../tmp/" + dir.substr(5));
+    assert(threads->get_value() == 0 && threads_changes == 4);
+    assert(port->get_value() == 9004);
+    system(("rm -rf " + dir).c_str());
+    return 0;
+}
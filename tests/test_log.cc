@@ -1,5 +1,7 @@
 #include "bluesky/log.h"
 #include "bluesky/util.h"
+#include <yaml-cpp/yaml.h>
+#include <assert.h>
 
 //std::shared_ptr<bluesky::Logger> logger = BLUESKY_LOG_ROOT();
 
@@ -14,6 +16,10 @@ int main(int argc, char *argv[])
     file_appender->set_level(bluesky::LogLevel::WARN);
     logger->add_appender(file_appender);
 
+    //慢速输出地使用异步appender包装,格式化结果通过队列交给后台线程
+    std::shared_ptr<bluesky::FileLogAppender> async_file(new bluesky::FileLogAppender("test_async.log"));
+    async_file->set_formatter(fmt);
+    logger->add_appender(std::shared_ptr<bluesky::LogAppender>(new bluesky::AsyncLogAppender(async_file)));
 
     BLUESKY_LOG_ERROR(logger) << "logger";
     BLUESKY_LOG_ERROR(logger) << "哈哈哈哈，终于解决啦";
@@ -22,6 +28,33 @@ int main(int argc, char *argv[])
 
     BLUESKY_LOG_DEBUG(BLUESKY_LOG_ROOT()) << "log root";
     BLUESKY_LOG_DEBUG(BLUESKY_LOG_ROOT()) << "SECOND log root";
+
+    bluesky::LogMetricsSnapshot snap = logger->get_metrics();
+    std::cout << snap.name << " lines=" << snap.total_lines() << " bytes=" << snap.bytes
+              << " p99=" << snap.percentile(0.99) << "ns" << std::endl;
+    for (auto &app : snap.appenders)
+    {
+        std::cout << "  " << app.name << " lines=" << app.total_lines() << " bytes=" << app.bytes
+                  << " suppressed=" << app.suppressed << " dropped=" << app.dropped << std::endl;
+    }
+    //toYamlString中Logger的字节数与get_metrics一致,取各个appender之和
+    YAML::Node node = YAML::Load(logger->toYamlString());
+    assert(snap.bytes > 0 && node["metrics"]["bytes"].as<uint64_t>() == snap.bytes);
+
+    //丢弃或者被过滤的日志不计入输出
+    std::shared_ptr<bluesky::Logger> dropping(new bluesky::Logger("dropping"));
+    std::shared_ptr<bluesky::AsyncLogAppender> full(new bluesky::AsyncLogAppender(
+        std::shared_ptr<bluesky::LogAppender>(new bluesky::StdoutLogAppender), 0));
+    dropping->add_appender(full);
+    BLUESKY_LOG_ERROR(dropping) << "dropped";
+    std::shared_ptr<bluesky::LogAppender> warn_only(new bluesky::StdoutLogAppender);
+    warn_only->set_level(bluesky::LogLevel::WARN);
+    dropping->add_appender(warn_only);
+    BLUESKY_LOG_INFO(dropping) << "suppressed";
+    bluesky::LogMetricsSnapshot dropped = dropping->get_metrics();
+    assert(dropped.total_lines() == 0 && dropped.bytes == 0 && dropped.latency_count == 0);
+    assert(dropped.appenders[0].total_lines() == 0 && dropped.appenders[0].dropped == 2);
+    assert(dropped.appenders[1].suppressed == 1);
     return 0;
 
 }
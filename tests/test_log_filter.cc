@@ -0,0 +1,89 @@
+#include "bluesky/log.h"
+#include <assert.h>
+
+//用于收集输出内容的appender
+class CountLogAppender : public bluesky::LogAppender
+{
+public:
+    typedef std::shared_ptr<CountLogAppender> Ptr;
+    virtual bool write(bluesky::LogLevel::Level level, const std::string &content) override
+    {
+        ++count;
+        return true;
+    }
+    virtual std::string toYamlString() override { return "type: CountLogAppender"; }
+    virtual std::string get_name() const override { return "count"; }
+
+    int count = 0;
+};
+
+static bool match(const std::string &expr, bluesky::LogLevel::Level level, const std::string &logger, const std::string &file)
+{
+    std::string error;
+    bluesky::LogFilter::Ptr filter = bluesky::LogFilter::compile(expr, &error);
+    if (!filter)
+    {
+        std::cout << error << std::endl;
+        assert(false);
+    }
+    bluesky::LogEvent event(logger, level, file, 10, 0, 1, 0, time(0));
+    return filter->match(level, event);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *expr = "level >= error || (level == debug && logger == \"system.fiber\" && file ~ \"*fiber.cc\")";
+    assert(match(expr, bluesky::LogLevel::ERROR, "root", "a.cc"));
+    assert(match(expr, bluesky::LogLevel::DEBUG, "system.fiber", "bluesky/fiber.cc"));
+    assert(!match(expr, bluesky::LogLevel::DEBUG, "system.fiber", "bluesky/thread.cc"));
+    assert(!match(expr, bluesky::LogLevel::INFO, "system.fiber", "bluesky/fiber.cc"));
+    assert(match("not (line < 5) and thread != 2", bluesky::LogLevel::INFO, "root", "a.cc"));
+    assert(match("logger ~ system.*", bluesky::LogLevel::INFO, "system.fiber", "a.cc"));
+
+    const char *bad[] = {"", "level >=", "levels == 1", "(level == 1", "logger < 'a'", "line ~ 1", "level == verbose"};
+    for (auto b : bad)
+    {
+        std::string error;
+        bool ok = bluesky::LogFilter::compile(b, &error) != nullptr;
+        std::cout << "'" << b << "' -> " << (ok ? "ok" : error) << std::endl;
+        assert(!ok || !*b);
+    }
+
+    bluesky::Logger::Ptr logger(new bluesky::Logger("system.fiber"));
+    CountLogAppender::Ptr all(new CountLogAppender);
+    CountLogAppender::Ptr errors(new CountLogAppender);
+    errors->set_filter(bluesky::LogFilter::compile("level >= error"));
+    logger->add_appender(all);
+    logger->add_appender(errors);
+    logger->set_filter(bluesky::LogFilter::compile(expr));
+
+    BLUESKY_LOG_DEBUG(logger) << "debug from test_log_filter.cc, filtered by logger";
+    BLUESKY_LOG_INFO(logger) << "info, filtered by logger";
+    BLUESKY_LOG_ERROR(logger) << "error";
+    assert(all->count == 1);
+    assert(errors->count == 1);
+
+    //被过滤的日志不进行格式化,统计为suppressed
+    logger->set_filter(nullptr);
+    BLUESKY_LOG_INFO(logger) << "info";
+    assert(all->count == 2);
+    assert(errors->count == 1);
+    std::cout << logger->toYamlString() << std::endl;
+
+    //过滤在构造日志事件之前进行,被过滤的日志内容表达式不会求值
+    const int N = 1000;
+    logger->set_filter(bluesky::LogFilter::compile("level >= error && logger ~ 'system.*'"));
+    uint64_t suppressed = logger->get_metrics().suppressed;
+    int evaluated = 0;
+    for (int i = 0; i < N; i++)
+    {
+        BLUESKY_LOG_INFO(logger) << "filtered " << ++evaluated;
+        BLUESKY_LOG_FMT_INFO(logger, "filtered %d", ++evaluated);
+    }
+    assert(evaluated == 0);
+    assert(logger->get_metrics().suppressed == suppressed + 2 * N);
+    assert(all->count == 2);
+    BLUESKY_LOG_ERROR(logger) << "accepted " << ++evaluated;
+    assert(evaluated == 1 && all->count == 3);
+    return 0;
+}
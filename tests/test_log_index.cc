@@ -0,0 +1,57 @@
+#include "bluesky/log.h"
+#include "bluesky/log_index.h"
+#include <assert.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <sys/wait.h>
+#include <fstream>
+
+//用bluesky_logq统计file中包含pattern的行数
+static int logq_count(const std::string &args)
+{
+    FILE *fp = popen(("./bluesky_logq -c " + args).c_str(), "r");
+    assert(fp);
+    int count = -1;
+    assert(fscanf(fp, "%d", &count) == 1);
+    pclose(fp);
+    return count;
+}
+
+int main(int argc, char *argv[])
+{
+    std::string file = "test_log_index.log";
+    unlink(file.c_str());
+    unlink(bluesky::LogIndex::index_path(file).c_str());
+    {
+        bluesky::FileLogAppender::Ptr appender(new bluesky::FileLogAppender(file));
+        appender->set_index(64);
+        for (int i = 0; i < 10; i++)
+        {
+            appender->write(bluesky::LogLevel::ERROR, "own-1 line " + std::to_string(i) + "\n");
+        }
+        //另一个写入者追加到同一个文件,appender在下一秒重新打开时发现文件大小变化
+        {
+            std::ofstream other(file, std::ios::app);
+            other << "foreign line\n";
+        }
+        sleep(1);
+        appender->write(bluesky::LogLevel::INFO, "own-2 line\n");
+    }
+
+    std::vector<bluesky::LogIndexEntry> entries;
+    assert(bluesky::LogIndex::load(bluesky::LogIndex::index_path(file), entries));
+    assert(entries.size() == 2);
+    //两个索引项首尾相接,没有未被索引的空隙
+    assert(entries[0].offset == 0 && entries[0].offset + entries[0].length == entries[1].offset);
+
+    //空隙中的行(appender自己写的以及其他写入者写的)都能被查询到
+    assert(logq_count(file + " own-1") == 10);
+    assert(logq_count(file + " foreign") == 1);
+    assert(logq_count("-l error " + file + " foreign") == 1);
+    assert(logq_count("-l error " + file + " own-2") == 0);
+    //级别名称不区分大小写,未知的级别报错退出
+    assert(logq_count("-l ERROR,Info " + file + " own-2") == 1);
+    int status = system(("./bluesky_logq -c -l eror " + file + " own 2>/dev/null >/dev/null").c_str());
+    assert(WIFEXITED(status) && WEXITSTATUS(status) == 2);
+    return 0;
+}
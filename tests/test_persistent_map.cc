@@ -0,0 +1,125 @@
+#include "bluesky/config.h"
+#include "bluesky/persistent_map.h"
+#include <assert.h>
+#include <random>
+
+//只用低4位的哈希,大量键会冲突并进入冲突节点
+struct BadHash
+{
+    size_t operator()(int key) const { return std::hash<int>()(key) & 0xf; }
+};
+
+template <class Map>
+static void check_equal(const Map &map, const std::map<int, int> &model)
+{
+    assert(map.size() == model.size());
+    for (auto &i : model)
+    {
+        assert(map.find(i.first) && *map.find(i.first) == i.second);
+    }
+    size_t count = 0;
+    map.for_each([&model, &count](const int &key, const int &value)
+                 {
+                     assert(model.at(key) == value);
+                     ++count;
+                 });
+    assert(count == model.size());
+}
+
+//随机增删与std::map对比,旧版本不受修改影响,diff只报告这一次修改
+template <class Map>
+static void random_ops(std::mt19937 &rand, int range)
+{
+    Map map;
+    std::map<int, int> model;
+    for (int i = 0; i < 20000; i++)
+    {
+        int key = rand() % range;
+        Map old = map;
+        bool existed = model.count(key);
+        int old_value = existed ? model[key] : 0;
+        std::map<int, int> old_model;
+        if (i % 1000 == 0)
+        {
+            old_model = model;
+        }
+        if (rand() % 3)
+        {
+            int value = rand() % 4;
+            map = map.set(key, value);
+            model[key] = value;
+        }
+        else
+        {
+            map = map.erase(key);
+            model.erase(key);
+        }
+        if (i % 1000 == 0)
+        {
+            check_equal(old, old_model);
+            check_equal(map, model);
+        }
+        bool exists = model.count(key);
+        bool changed = existed != exists || (exists && model[key] != old_value);
+        size_t changes = 0;
+        Map::diff(old, map, [&](const int &k, const int *o, const int *n)
+                  {
+                      assert(k == key);
+                      assert(o ? existed && *o == old_value : !existed);
+                      assert(n ? exists && *n == model[key] : !exists);
+                      ++changes;
+                  });
+        assert(changes == (changed ? 1u : 0u));
+        assert((old == map) == !changed);
+    }
+    check_equal(map, model);
+}
+
+int main(int argc, char *argv[])
+{
+    std::mt19937 rand(2024);
+    random_ops<bluesky::PersistentMap<int, int>>(rand, 5000);
+    random_ops<bluesky::PersistentMap<int, int, BadHash>>(rand, 300);
+
+    //独立构造的两个内容相同的映射相等,树形相同
+    bluesky::PersistentMap<int, int> a, b;
+    for (int i = 0; i < 1000; i++)
+    {
+        a = a.set(i, i);
+        b = b.set(999 - i, 999 - i);
+    }
+    assert(a == b);
+    b = b.set(5, 6).erase(7);
+    int changes = 0;
+    bluesky::PersistentMap<int, int>::diff(a, b, [&changes](const int &key, const int *old_value, const int *new_value)
+                                           { ++changes; });
+    assert(changes == 2);
+
+    //配置:重新加载之后与旧版本共享节点,内容与文件一致
+    typedef bluesky::PersistentMap<std::string, int> Routes;
+    auto routes = bluesky::Config::lookup("persistent.routes", Routes(), "routes");
+    std::string yaml = "persistent:\n  routes:\n";
+    for (int i = 0; i < 1000; i++)
+    {
+        yaml += "    r" + std::to_string(i) + ": " + std::to_string(i) + "\n";
+    }
+    assert(bluesky::Config::load_from_yaml(YAML::Load(yaml)));
+    auto old_value = routes->get_snapshot();
+    assert(old_value->size() == 1000 && *old_value->find("r10") == 10);
+
+    std::vector<std::string> changed;
+    routes->add_listener([&changed](const Routes &old_value, const Routes &new_value)
+                         {
+                             Routes::diff(old_value, new_value, [&changed](const std::string &key, const int *o, const int *n)
+                                          { changed.push_back(key); });
+                         });
+    yaml += "    r1000: 1000\n";
+    assert(bluesky::Config::load_from_yaml(YAML::Load(yaml)));
+    assert(changed.size() == 1 && changed[0] == "r1000");
+    assert(routes->get_value().size() == 1001);
+
+    Routes parsed = bluesky::LexicalCast<std::string, Routes>()(routes->toString());
+    assert(parsed == routes->get_value());
+    std::cout << "persistent map ok" << std::endl;
+    return 0;
+}
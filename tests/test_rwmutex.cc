@@ -0,0 +1,135 @@
+#include "bluesky/locker.h"
+#include "bluesky/thread.h"
+#include <assert.h>
+#include <unistd.h>
+#include <iostream>
+#include <vector>
+
+//读锁可以同时持有,写锁与读锁、写锁互斥
+template <class MutexType>
+static void test_exclusion(MutexType &mutex)
+{
+    std::atomic<int> state{0};
+    {
+        typename MutexType::ReadLock lock(mutex);
+        //持有读锁时其他线程仍然可以加读锁
+        bluesky::Thread reader([&mutex, &state]()
+                               {
+                                   typename MutexType::ReadLock lock(mutex);
+                                   state = 1;
+                               },
+                               "reader");
+        reader.join();
+        assert(state == 1);
+    }
+    {
+        typename MutexType::WriteLock lock(mutex);
+        bluesky::Thread reader([&mutex, &state]()
+                               {
+                                   typename MutexType::ReadLock lock(mutex);
+                                   state = 2;
+                               },
+                               "reader");
+        usleep(50 * 1000);
+        assert(state == 1);
+        //守卫可以提前释放,析构时不会重复释放
+        lock.unlock();
+        reader.join();
+        assert(state == 2);
+        lock.lock();
+        state = 3;
+    }
+    //守卫析构时释放了写锁
+    typename MutexType::WriteLock lock(mutex);
+    assert(state == 3);
+}
+
+//有写者等待时新的读者排在写者之后
+template <class MutexType>
+static void test_writer_preference(MutexType &mutex)
+{
+    std::atomic<int> order{0};
+    std::atomic<int> writer_order{0};
+    std::atomic<int> reader_order{0};
+    typename MutexType::ReadLock lock(mutex);
+    bluesky::Thread writer([&]()
+                           {
+                               typename MutexType::WriteLock lock(mutex);
+                               writer_order = ++order;
+                           },
+                           "writer");
+    usleep(50 * 1000);
+    bluesky::Thread reader([&]()
+                           {
+                               typename MutexType::ReadLock lock(mutex);
+                               reader_order = ++order;
+                           },
+                           "reader");
+    usleep(50 * 1000);
+    assert(order == 0);
+    lock.unlock();
+    writer.join();
+    reader.join();
+    assert(writer_order == 1 && reader_order == 2);
+}
+
+//并发读写:读者总是看到写者在一次写锁内修改的两个值相等
+template <class MutexType>
+static void test_concurrent(MutexType &mutex)
+{
+    int64_t a = 0;
+    int64_t b = 0;
+    std::vector<bluesky::Thread::Ptr> threads;
+    for (int i = 0; i < 8; i++)
+    {
+        bool write = i % 4 == 0;
+        threads.push_back(bluesky::Thread::Ptr(new bluesky::Thread([&mutex, &a, &b, write]()
+                                                                   {
+                                                                       for (int n = 0; n < 20000; n++)
+                                                                       {
+                                                                           if (write)
+                                                                           {
+                                                                               typename MutexType::WriteLock lock(mutex);
+                                                                               a++;
+                                                                               b++;
+                                                                           }
+                                                                           else
+                                                                           {
+                                                                               typename MutexType::ReadLock lock(mutex);
+                                                                               assert(a == b);
+                                                                           }
+                                                                       }
+                                                                   },
+                                                                   "worker_" + std::to_string(i))));
+    }
+    for (auto &t : threads)
+    {
+        t->join();
+    }
+    assert(a == 2 * 20000 && b == a);
+}
+
+int main(int argc, char *argv[])
+{
+    bluesky::RWMutex rwmutex;
+    test_exclusion(rwmutex);
+    test_concurrent(rwmutex);
+
+    bluesky::RWMutex writer_first(true);
+    test_exclusion(writer_first);
+    test_writer_preference(writer_first);
+    test_concurrent(writer_first);
+
+    bluesky::ShardedRWMutex sharded;
+    test_exclusion(sharded);
+    test_writer_preference(sharded);
+    test_concurrent(sharded);
+
+    bluesky::NullRWMutex null_mutex;
+    {
+        bluesky::NullRWMutex::ReadLock rlock(null_mutex);
+        bluesky::NullRWMutex::WriteLock wlock(null_mutex);
+    }
+    std::cout << "test_rwmutex ok" << std::endl;
+    return 0;
+}
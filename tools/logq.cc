@@ -0,0 +1,227 @@
+#include "bluesky/log.h"
+#include "bluesky/log_index.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+
+/* bluesky_logq: 利用FileLogAppender写出的稀疏索引查询日志
+ * 用法: bluesky_logq [-b begin] [-e end] [-l levels] [-c] [-s] logfile [pattern]
+ *      -b/-e   时间范围,"YYYY-mm-dd HH:MM:SS"或者时间戳(秒)
+ *      -l      日志级别,逗号分隔,例如 error,fatal
+ *      -c      只输出匹配的行数
+ *      -s      在stderr输出扫描统计
+ * 只扫描索引中时间范围和级别都匹配的块,过滤的粒度是块而不是行;
+ * 没有索引文件时退化为扫描整个文件
+ */
+
+static uint64_t parse_time(const char *str)
+{
+    struct tm tm;
+    memset(&tm, 0, sizeof(tm));
+    const char *end = strptime(str, "%Y-%m-%d %H:%M:%S", &tm);
+    if (end && *end == '\0')
+    {
+        tm.tm_isdst = -1;
+        return mktime(&tm);
+    }
+    return strtoull(str, nullptr, 10);
+}
+
+//级别名称不区分大小写,有未知的名称时输出错误并返回false
+static bool parse_levels(const char *str, uint32_t &levels)
+{
+    levels = 0;
+    std::string value(str);
+    size_t begin = 0;
+    while (begin <= value.size())
+    {
+        size_t end = value.find(',', begin);
+        if (end == std::string::npos)
+        {
+            end = value.size();
+        }
+        std::string name = value.substr(begin, end - begin);
+        std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+        bool found = false;
+        for (int i = bluesky::LogLevel::DEBUG; i <= bluesky::LogLevel::FATAL; i++)
+        {
+            if (name == bluesky::LogLevel::to_string((bluesky::LogLevel::Level)i))
+            {
+                levels |= 1u << i;
+                found = true;
+            }
+        }
+        if (!found)
+        {
+            fprintf(stderr, "unknown level: '%s', expected debug/info/warn/error/fatal\n", name.c_str());
+            return false;
+        }
+        begin = end + 1;
+    }
+    return true;
+}
+
+//glibc的memchr使用SIMD实现:先用memchr定位needle的首字节,再比较剩余部分
+static const char *find_substring(const char *begin, const char *end, const std::string &needle)
+{
+    size_t n = needle.size();
+    while ((size_t)(end - begin) >= n)
+    {
+        const char *p = (const char *)memchr(begin, needle[0], end - begin - n + 1);
+        if (!p)
+        {
+            return nullptr;
+        }
+        if (memcmp(p + 1, needle.data() + 1, n - 1) == 0)
+        {
+            return p;
+        }
+        begin = p + 1;
+    }
+    return nullptr;
+}
+
+//在[begin, end)中查找包含pattern的行,count_only为false时输出整行
+static uint64_t scan(const char *begin, const char *end, const std::string &pattern, bool count_only)
+{
+    uint64_t matched = 0;
+    if (pattern.empty())
+    {
+        if (!count_only)
+        {
+            fwrite(begin, 1, end - begin, stdout);
+        }
+        for (const char *p = begin; p < end; ++p)
+        {
+            p = (const char *)memchr(p, '\n', end - p);
+            if (!p)
+            {
+                break;
+            }
+            ++matched;
+        }
+        return matched;
+    }
+    const char *pos = begin;
+    while (pos < end)
+    {
+        const char *hit = find_substring(pos, end, pattern);
+        if (!hit)
+        {
+            break;
+        }
+        const char *line_begin = (const char *)memrchr(begin, '\n', hit - begin);
+        line_begin = line_begin ? line_begin + 1 : begin;
+        const char *line_end = (const char *)memchr(hit, '\n', end - hit);
+        line_end = line_end ? line_end + 1 : end;
+        if (!count_only)
+        {
+            fwrite(line_begin, 1, line_end - line_begin, stdout);
+        }
+        ++matched;
+        pos = line_end;
+    }
+    return matched;
+}
+
+int main(int argc, char **argv)
+{
+    uint64_t begin_time = 0;
+    uint64_t end_time = 0;
+    uint32_t levels = 0;
+    bool count_only = false;
+    bool stats = false;
+    int opt;
+    while ((opt = getopt(argc, argv, "b:e:l:cs")) != -1)
+    {
+        switch (opt)
+        {
+        case 'b':
+            begin_time = parse_time(optarg);
+            break;
+        case 'e':
+            end_time = parse_time(optarg);
+            break;
+        case 'l':
+            if (!parse_levels(optarg, levels))
+            {
+                fprintf(stderr, "usage: %s [-b begin] [-e end] [-l levels] [-c] [-s] logfile [pattern]\n", argv[0]);
+                return 2;
+            }
+            break;
+        case 'c':
+            count_only = true;
+            break;
+        case 's':
+            stats = true;
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-b begin] [-e end] [-l levels] [-c] [-s] logfile [pattern]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (optind >= argc)
+    {
+        fprintf(stderr, "usage: %s [-b begin] [-e end] [-l levels] [-c] [-s] logfile [pattern]\n", argv[0]);
+        return 2;
+    }
+    std::string file = argv[optind];
+    std::string pattern = optind + 1 < argc ? argv[optind + 1] : "";
+
+    int fd = open(file.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0)
+    {
+        fprintf(stderr, "open %s failed: %s\n", file.c_str(), strerror(errno));
+        return 1;
+    }
+    uint64_t size = st.st_size;
+    if (size == 0)
+    {
+        return 0;
+    }
+    const char *data = (const char *)mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED)
+    {
+        fprintf(stderr, "mmap %s failed: %s\n", file.c_str(), strerror(errno));
+        return 1;
+    }
+
+    std::vector<bluesky::LogIndexEntry> entries;
+    std::vector<std::pair<uint64_t, uint64_t>> ranges;
+    if (bluesky::LogIndex::load(bluesky::LogIndex::index_path(file), entries) && !entries.empty())
+    {
+        ranges = bluesky::LogIndex::select(entries, size, begin_time, end_time, levels);
+    }
+    else
+    {
+        ranges.push_back(std::make_pair(0, size));
+    }
+
+    uint64_t matched = 0;
+    uint64_t scanned = 0;
+    for (auto &range : ranges)
+    {
+        uint64_t page_begin = range.first & ~(uint64_t)(getpagesize() - 1);
+        madvise((void *)(data + page_begin), range.second - page_begin, MADV_SEQUENTIAL);
+        matched += scan(data + range.first, data + range.second, pattern, count_only);
+        scanned += range.second - range.first;
+    }
+    if (count_only)
+    {
+        printf("%lu\n", (unsigned long)matched);
+    }
+    if (stats)
+    {
+        fprintf(stderr, "index_entries=%lu ranges=%lu scanned=%lu/%lu bytes matched=%lu\n",
+                (unsigned long)entries.size(), (unsigned long)ranges.size(),
+                (unsigned long)scanned, (unsigned long)size, (unsigned long)matched);
+    }
+    munmap((void *)data, size);
+    close(fd);
+    return 0;
+}